@@ -0,0 +1,192 @@
+#include "batch.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "blocking_queue.h"
+
+namespace fs = std::filesystem;
+
+// an image on its way through the pipeline
+struct BatchItem {
+    size_t job = 0;
+    std::unique_ptr<tga::TGAImage> image;
+};
+
+// matches * and ? against the whole name
+static bool matchesPattern(const std::string& name, const std::string& pattern) {
+    size_t n = 0, p = 0;
+    size_t starPattern = std::string::npos, starName = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            n++;
+            p++;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            starPattern = p++;
+            starName = n;
+        } else if (starPattern != std::string::npos) {
+            p = starPattern + 1;
+            n = ++starName;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*')
+        p++;
+    return p == pattern.size();
+}
+
+static bool isTgaFile(const fs::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+    return extension == ".tga";
+}
+
+std::vector<BatchJob> collectBatchJobs(const std::string& input, const std::string& outputDirectory) {
+    std::vector<std::string> inputs;
+    fs::path inputPath(input);
+    std::string fileName = inputPath.filename().string();
+    std::error_code error;
+
+    if (fs::is_directory(inputPath, error)) {
+        for (const auto& entry : fs::directory_iterator(inputPath, error))
+            if (entry.is_regular_file() && isTgaFile(entry.path()))
+                inputs.push_back(entry.path().string());
+    } else if (fileName.find_first_of("*?") != std::string::npos) {
+        fs::path directory = inputPath.has_parent_path() ? inputPath.parent_path() : fs::path(".");
+        for (const auto& entry : fs::directory_iterator(directory, error))
+            if (entry.is_regular_file() && matchesPattern(entry.path().filename().string(), fileName))
+                inputs.push_back(entry.path().string());
+    } else {
+        std::ifstream list(input);
+        if (!list.good()) {
+            std::cout << "could not open the batch list " << input << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::string line;
+        while (std::getline(list, line)) {
+            // tolerate windows line endings and blank lines
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (!line.empty())
+                inputs.push_back(line);
+        }
+    }
+
+    // directory listings come in no particular order
+    std::sort(inputs.begin(), inputs.end());
+
+    fs::create_directories(outputDirectory, error);
+
+    std::vector<BatchJob> jobs;
+    for (const std::string& path : inputs) {
+        BatchJob job;
+        job.inFilePath = path;
+        job.outFilePath = (fs::path(outputDirectory) / fs::path(path).filename()).string();
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+BatchResult runBatch(const std::vector<BlurBackend*>& engines, const std::vector<BatchJob>& jobs, const BatchOptions& options) {
+    int slots = 0;
+    for (BlurBackend* engine : engines)
+        slots += engine->slotCount();
+    int readerThreads = std::max(1, options.readerThreads);
+    int writerThreads = std::max(1, options.writerThreads);
+
+    // enough decoded images to refill every slot while the readers are busy
+    BlockingQueue<BatchItem> loaded(slots + readerThreads);
+    BlockingQueue<BatchItem> blurred(slots + writerThreads);
+    std::atomic<size_t> nextJob(0);
+    std::atomic<size_t> failed(0);
+    std::atomic<size_t> written(0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // reader stage, decodes the next images from disk
+    std::atomic<int> activeReaders(readerThreads);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < readerThreads; i++) {
+        readers.emplace_back([&]() {
+            for (size_t job = nextJob++; job < jobs.size(); job = nextJob++) {
+                BatchItem item;
+                item.job = job;
+                item.image.reset(new tga::TGAImage());
+                if (!tga::LoadTGA(item.image.get(), jobs[job].inFilePath.c_str()) || item.image->imageData.empty()) {
+                    failed++;
+                    continue;
+                }
+                loaded.push(std::move(item));
+            }
+            if (--activeReaders == 0)
+                loaded.close();
+        });
+    }
+
+    // writer stage, encodes finished images
+    std::vector<std::thread> writers;
+    for (int i = 0; i < writerThreads; i++) {
+        writers.emplace_back([&]() {
+            BatchItem item;
+            while (blurred.pop(item)) {
+                if (tga::saveTGAInPlace(*item.image, jobs[item.job].outFilePath.c_str()))
+                    written++;
+                else
+                    failed++;
+                item.image.reset();
+            }
+        });
+    }
+
+    // device stage, one thread per engine keeps all of its slots busy and retires them round robin
+    std::vector<size_t> blurredPerEngine(engines.size(), 0);
+    std::vector<std::thread> devices;
+    for (size_t e = 0; e < engines.size(); e++) {
+        devices.emplace_back([&, e]() {
+            BlurBackend& engine = *engines[e];
+            int engineSlots = engine.slotCount();
+            std::vector<BatchItem> inFlight(engineSlots);
+            int slot = 0;
+            BatchItem item;
+            while (loaded.pop(item)) {
+                if (inFlight[slot].image) {
+                    engine.finish(slot);
+                    blurred.push(std::move(inFlight[slot]));
+                }
+                engine.blurAsync(slot, *item.image, options.kernelSize, options.sigma, options.precision, options.method);
+                inFlight[slot] = std::move(item);
+                blurredPerEngine[e]++;
+                slot = (slot + 1) % engineSlots;
+            }
+            for (int i = 0; i < engineSlots; i++, slot = (slot + 1) % engineSlots) {
+                if (inFlight[slot].image) {
+                    engine.finish(slot);
+                    blurred.push(std::move(inFlight[slot]));
+                }
+            }
+        });
+    }
+    for (std::thread& device : devices)
+        device.join();
+    blurred.close();
+
+    for (std::thread& reader : readers)
+        reader.join();
+    for (std::thread& writer : writers)
+        writer.join();
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    BatchResult result;
+    result.blurred = written;
+    result.failed = failed;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.blurredPerEngine = blurredPerEngine;
+    return result;
+}
@@ -0,0 +1,41 @@
+#ifndef GAUSSIAN_BLUR_BATCH_H
+#define GAUSSIAN_BLUR_BATCH_H
+
+#include <string>
+#include <vector>
+#include "blur_backend.h"
+
+struct BatchJob {
+    std::string inFilePath;
+    std::string outFilePath;
+};
+
+struct BatchOptions {
+    int kernelSize = 0;
+    double sigma = 0.0;
+    Precision precision = Precision::Float;
+    BlurMethod method = BlurMethod::Exact;
+    int readerThreads = 2;
+    int writerThreads = 2;
+};
+
+struct BatchResult {
+    size_t blurred = 0;
+    size_t failed = 0;
+    double seconds = 0.0;
+    // images blurred by each of the engines, in the order they were passed
+    std::vector<size_t> blurredPerEngine;
+};
+
+// Expands the batch input into tga files: a directory yields all .tga files in it, a path with
+// * or ? in the file name is matched against its directory, and any other file is read as a list
+// with one input path per line. The outputs get the same file names inside outputDirectory.
+std::vector<BatchJob> collectBatchJobs(const std::string& input, const std::string& outputDirectory);
+
+// Blurs all jobs in a pipeline: reader threads decode the next images while every engine keeps
+// one image per slot in flight and writer threads encode the finished ones, so the devices
+// do not wait for the disk. Each engine takes the next image as soon as it has a free slot,
+// which hands faster devices more of the batch.
+BatchResult runBatch(const std::vector<BlurBackend*>& engines, const std::vector<BatchJob>& jobs, const BatchOptions& options);
+
+#endif //GAUSSIAN_BLUR_BATCH_H
@@ -0,0 +1,54 @@
+#ifndef GAUSSIAN_BLUR_BLOCKING_QUEUE_H
+#define GAUSSIAN_BLUR_BLOCKING_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Bounded queue that connects the stages of a pipeline. Producers block while it is full,
+// consumers block while it is empty. After close, pop drains the remaining items and then fails.
+template <typename T>
+class BlockingQueue {
+public:
+    explicit BlockingQueue(size_t capacity) : capacity(capacity) {}
+
+    // returns false if the queue was closed and the value was dropped
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [&]() { return closed || items.size() < capacity; });
+        if (closed)
+            return false;
+        items.push_back(std::move(value));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // returns false once the queue is closed and empty
+    bool pop(T& value) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [&]() { return closed || !items.empty(); });
+        if (items.empty())
+            return false;
+        value = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+};
+
+#endif //GAUSSIAN_BLUR_BLOCKING_QUEUE_H
@@ -0,0 +1,966 @@
+#include "blur_engine.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include "gaussian_blur.h"
+#include "gauss_cl.h"
+
+// every pixel of a tile is stored as uchar4 in local memory, RGB pixels are padded
+static const int localPixelSize = 4;
+
+static size_t weightSize(Precision precision) {
+    switch (precision) {
+    case Precision::Double: return sizeof(cl_double);
+    case Precision::Half:   return sizeof(cl_half);
+    case Precision::Fixed:  return sizeof(cl_short);
+    default:                return sizeof(cl_float);
+    }
+}
+
+static std::string buildOptions(Precision precision, bool constantWeights, int channels) {
+    std::string options = "-D CHANNELS=" + std::to_string(channels);
+    if (precision == Precision::Double)
+        options += " -D USE_DOUBLE";
+    else if (precision == Precision::Half)
+        options += " -D USE_HALF";
+    else if (precision == Precision::Fixed)
+        options += " -D USE_FIXED -D FIXED_BITS=" + std::to_string(fixedPointBits);
+
+    if (!constantWeights)
+        options += " -D WEIGHT_SPACE=__global";
+
+    // four channel images are blurred with premultiplied alpha in the same vectorized pass
+    if (channels == 4)
+        options += " -D PREMULTIPLY_ALPHA";
+
+    return options;
+}
+
+// kernels up to this size get a program with the weights and the tap count compiled in
+static const int maxSpecializedKernelSize = 1025;
+
+// upper bound for the pixels a single work-item blurs along the pass direction
+static const int maxPixelsPerItem = 16;
+
+// the autotuner tries work-groups up to this size and keeps the best of this many timed runs
+static const size_t maxAutotuneWorkGroupSize = 1024;
+static const int autotuneRuns = 3;
+
+const char* precisionName(Precision precision) {
+    switch (precision) {
+    case Precision::Double: return "double";
+    case Precision::Half:   return "half";
+    case Precision::Fixed:  return "fixed";
+    default:                return "float";
+    }
+}
+
+const char* verticalPassName(VerticalPass verticalPass) {
+    return verticalPass == VerticalPass::Transposed ? "transposed" : "direct";
+}
+
+const char* methodName(BlurMethod method) {
+    switch (method) {
+    case BlurMethod::Box3: return "box3";
+    case BlurMethod::Iir:  return "iir";
+    default:               return "exact";
+    }
+}
+
+int blurRadius(BlurMethod method, int kernelSize, double sigma) {
+    if (method == BlurMethod::Box3) {
+        int radii[3];
+        _box_blur_radii(sigma, 3, radii);
+        return radii[0] + radii[1] + radii[2];
+    }
+    // the response of the recursive filter never ends, past four sigma it is below 8 bit precision
+    if (method == BlurMethod::Iir)
+        return (int)ceil(4.0 * sigma);
+    return kernelSize / 2;
+}
+
+BlurEngine::BlurEngine(const EngineOptions& options) : programCache(options.programCacheDirectory), tuning(options.tuningFile) {
+    // used for checking error status of api calls
+    cl_int status;
+
+    // retrieve the number of platforms
+    cl_uint numPlatforms = 0;
+    checkStatus(clGetPlatformIDs(0, NULL, &numPlatforms));
+
+    if (numPlatforms == 0) {
+        printf("Error: No OpenCL platform available!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // select the platform
+    if (options.platformIndex < 0 || options.platformIndex >= (int)numPlatforms) {
+        printf("Error: Platform %d is not available!\n", options.platformIndex);
+        exit(EXIT_FAILURE);
+    }
+    std::vector<cl_platform_id> platforms(numPlatforms);
+    checkStatus(clGetPlatformIDs(numPlatforms, platforms.data(), NULL));
+    platform = platforms[options.platformIndex];
+
+    // retrieve the number of devices
+    cl_uint numDevices = 0;
+    checkStatus(clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 0, NULL, &numDevices));
+
+    if (numDevices == 0) {
+        printf("Error: No OpenCL device available for platform!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // select the device
+    if (options.deviceIndex < 0 || options.deviceIndex >= (int)numDevices) {
+        printf("Error: Device %d is not available on platform %d!\n", options.deviceIndex, options.platformIndex);
+        exit(EXIT_FAILURE);
+    }
+    std::vector<cl_device_id> devices(numDevices);
+    checkStatus(clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, numDevices, devices.data(), NULL));
+    device = devices[options.deviceIndex];
+
+    // the limits of the device decide the work-group and tile shapes, where the weights are
+    // stored, which precisions can be used and how the image gets to the device
+    info = queryDeviceInfo(platform, device);
+    info.platformIndex = options.platformIndex;
+    info.deviceIndex = options.deviceIndex;
+
+    verticalPass = options.verticalPass;
+
+    if (options.hostMemory == HostMemory::Auto)
+        zeroCopy = info.hostUnifiedMemory;
+    else
+        zeroCopy = options.hostMemory == HostMemory::ZeroCopy;
+
+    // create context
+    context = clCreateContext(NULL, 1, &device, NULL, NULL, &status);
+    checkStatus(status);
+
+    // create one command queue per image in flight
+    slots.resize(options.inFlightImages > 1 ? options.inFlightImages : 1);
+    for (Slot& slot : slots) {
+        slot.commandQueue = clCreateCommandQueue(context, device, 0, &status);
+        checkStatus(status);
+    }
+
+    if (options.kernelFileName.empty()) {
+        // use the kernel source that was embedded at build time
+        programSource = reinterpret_cast<const char*>(gaussKernelSource);
+    } else {
+        // read the kernel source
+        std::ifstream ifs(options.kernelFileName);
+        if (!ifs.good()) {
+            printf("Error: Could not open kernel with file name %s!\n", options.kernelFileName.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        // load the opencl kernel
+        programSource = std::string((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    }
+}
+
+BlurEngine::~BlurEngine() {
+    for (int i = 0; i < slotCount(); i++) {
+        finish(i);
+        if (slots[i].bufferImage) clReleaseMemObject(slots[i].bufferImage);
+        if (slots[i].bufferTemp) clReleaseMemObject(slots[i].bufferTemp);
+        if (slots[i].bufferTransposed) clReleaseMemObject(slots[i].bufferTransposed);
+        if (slots[i].bufferLines) clReleaseMemObject(slots[i].bufferLines);
+        if (slots[i].bufferRing) clReleaseMemObject(slots[i].bufferRing);
+    }
+    if (bufferBlurKernel) clReleaseMemObject(bufferBlurKernel);
+    if (bufferConvolution) clReleaseMemObject(bufferConvolution);
+    for (auto& entry : programs) {
+        clReleaseKernel(entry.second.horizontalKernel);
+        clReleaseKernel(entry.second.verticalKernel);
+        clReleaseKernel(entry.second.transposedKernel);
+        clReleaseKernel(entry.second.transposeKernel);
+        // specialized programs have none of the other kernels
+        if (entry.second.boxKernel) {
+            clReleaseKernel(entry.second.boxKernel);
+            clReleaseKernel(entry.second.iirKernel);
+            clReleaseKernel(entry.second.convolveKernel);
+            clReleaseKernel(entry.second.fftLoadKernel);
+            clReleaseKernel(entry.second.fftLinesKernel);
+            clReleaseKernel(entry.second.fftMultiplyKernel);
+            clReleaseKernel(entry.second.fftAccumulateKernel);
+            clReleaseKernel(entry.second.convolveStoreKernel);
+        }
+        clReleaseProgram(entry.second.program);
+    }
+    for (Slot& slot : slots)
+        clReleaseCommandQueue(slot.commandQueue);
+    if (context) clReleaseContext(context);
+}
+
+const BlurEngine::BlurProgram& BlurEngine::getProgram(const std::string& buildOptions, const std::string& sourceHeader) {
+    std::string key = buildOptions + "\n" + sourceHeader;
+    auto cached = programs.find(key);
+    if (cached != programs.end())
+        return cached->second;
+
+    cl_int status;
+
+    // build the program, or load it from the on-disk cache of an earlier run
+    BlurProgram blurProgram;
+    blurProgram.program = programCache.build(context, platform, device, sourceHeader + programSource, buildOptions);
+
+    // create the blur kernels
+    blurProgram.horizontalKernel = clCreateKernel(blurProgram.program, "blur_horizontal", &status);
+    checkStatus(status);
+    blurProgram.verticalKernel = clCreateKernel(blurProgram.program, "blur_vertical", &status);
+    checkStatus(status);
+    blurProgram.transposedKernel = clCreateKernel(blurProgram.program, "blur_transposed", &status);
+    checkStatus(status);
+    blurProgram.transposeKernel = clCreateKernel(blurProgram.program, "transpose", &status);
+    checkStatus(status);
+
+    // specialized programs are built without the line filters and the convolutions
+    bool specialized = !sourceHeader.empty();
+    if (specialized)
+        return programs[key] = blurProgram;
+
+    blurProgram.boxKernel = clCreateKernel(blurProgram.program, "box_blur", &status);
+    checkStatus(status);
+    blurProgram.iirKernel = clCreateKernel(blurProgram.program, "iir_blur", &status);
+    checkStatus(status);
+    blurProgram.convolveKernel = clCreateKernel(blurProgram.program, "convolve_direct", &status);
+    checkStatus(status);
+    blurProgram.fftLoadKernel = clCreateKernel(blurProgram.program, "fft_load_tiles", &status);
+    checkStatus(status);
+    blurProgram.fftLinesKernel = clCreateKernel(blurProgram.program, "fft_lines", &status);
+    checkStatus(status);
+    blurProgram.fftMultiplyKernel = clCreateKernel(blurProgram.program, "fft_multiply", &status);
+    checkStatus(status);
+    blurProgram.fftAccumulateKernel = clCreateKernel(blurProgram.program, "fft_accumulate", &status);
+    checkStatus(status);
+    blurProgram.convolveStoreKernel = clCreateKernel(blurProgram.program, "convolve_store", &status);
+    checkStatus(status);
+
+    return programs[key] = blurProgram;
+}
+
+const BlurEngine::BlurProgram& BlurEngine::getSpecializedProgram(int kernelSize, double sigma, Precision precision, int channels) {
+    auto key = std::make_tuple(kernelSize, sigma, precision, channels);
+    auto cached = specializedPrograms.find(key);
+    if (cached != specializedPrograms.end())
+        return *cached->second;
+
+    // emit the center weight and the weights of increasing distance as literals of the compute type,
+    // half programs get float literals that the compiler rounds to half
+    double* blurKernel = _1d_blur_kernel(kernelSize, sigma);
+    short* fixedKernel = precision == Precision::Fixed ? _1d_blur_kernel_fixed(kernelSize, sigma, fixedPointBits) : NULL;
+    int radius = kernelSize / 2;
+
+    std::string sourceHeader = "#define BLUR_WEIGHTS ";
+    char literal[32];
+    for (int i = 0; i <= radius; i++) {
+        if (precision == Precision::Double)
+            snprintf(literal, sizeof(literal), "%.17e", blurKernel[radius + i]);
+        else if (precision == Precision::Fixed)
+            snprintf(literal, sizeof(literal), "%d", fixedKernel[radius + i]);
+        else
+            snprintf(literal, sizeof(literal), "%.9ef", (float)blurKernel[radius + i]);
+        sourceHeader += literal;
+        sourceHeader += i < radius ? ", " : "\n";
+    }
+    delete[] blurKernel;
+    delete[] fixedKernel;
+
+    std::string options = buildOptions(precision, true, channels) + " -D KSIZE=" + std::to_string(kernelSize);
+    const BlurProgram& blurProgram = getProgram(options, sourceHeader);
+    specializedPrograms[key] = &blurProgram;
+    return blurProgram;
+}
+
+void BlurEngine::reserveBuffer(cl_mem& buffer, size_t& capacity, size_t size) {
+    if (size <= capacity)
+        return;
+
+    // grow only, the old contents are not needed anymore
+    if (buffer) clReleaseMemObject(buffer);
+
+    cl_int status;
+    buffer = clCreateBuffer(context, CL_MEM_READ_WRITE, size, NULL, &status);
+    checkStatus(status);
+    capacity = size;
+}
+
+bool BlurEngine::supportsPrecision(Precision precision) const {
+    switch (precision) {
+    case Precision::Double: return info.fp64;
+    case Precision::Half:   return info.fp16;
+    default:                return true;
+    }
+}
+
+Precision BlurEngine::preferredPrecision() const {
+    // devices that emulate half through float gain nothing but the rounding error
+    return info.fp16 && info.nativeVectorWidthHalf > 0 ? Precision::Half : Precision::Float;
+}
+
+void BlurEngine::uploadBlurKernel(cl_command_queue commandQueue, int kernelSize, double sigma, Precision precision) {
+    // consecutive images mostly share the same parameters, skip the upload then
+    if (kernelSize == currentKernelSize && sigma == currentSigma && precision == currentPrecision)
+        return;
+
+    // images in flight may still read the old weights
+    for (int i = 0; i < slotCount(); i++)
+        finish(i);
+
+    cl_int status;
+    size_t blurKernelSize = weightSize(precision) * kernelSize;
+    if (blurKernelSize > blurKernelCapacity) {
+        if (bufferBlurKernel) clReleaseMemObject(bufferBlurKernel);
+        bufferBlurKernel = clCreateBuffer(context, CL_MEM_READ_ONLY, blurKernelSize, NULL, &status);
+        checkStatus(status);
+        blurKernelCapacity = blurKernelSize;
+    }
+
+    // generate the requested kernel in the type the program computes with
+    void* blurKernel;
+    if (precision == Precision::Double)
+        blurKernel = _1d_blur_kernel(kernelSize, sigma);
+    else if (precision == Precision::Half)
+        blurKernel = _1d_blur_kernel_half(kernelSize, sigma);
+    else if (precision == Precision::Fixed)
+        blurKernel = _1d_blur_kernel_fixed(kernelSize, sigma, fixedPointBits);
+    else
+        blurKernel = _1d_blur_kernel_float(kernelSize, sigma);
+
+    status = clEnqueueWriteBuffer(commandQueue, bufferBlurKernel, CL_TRUE, 0, blurKernelSize, blurKernel, 0, NULL, NULL);
+
+    if (precision == Precision::Double)
+        delete[] static_cast<double*>(blurKernel);
+    else if (precision == Precision::Half)
+        delete[] static_cast<unsigned short*>(blurKernel);
+    else if (precision == Precision::Fixed)
+        delete[] static_cast<short*>(blurKernel);
+    else
+        delete[] static_cast<float*>(blurKernel);
+    checkStatus(status);
+
+    currentKernelSize = kernelSize;
+    currentSigma = sigma;
+    currentPrecision = precision;
+}
+
+static size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+static size_t divideRoundUp(size_t value, size_t divisor) {
+    return (value + divisor - 1) / divisor;
+}
+
+void BlurEngine::preferredWorkGroup(cl_kernel kernel, int alongAxis, size_t localWorkSize[2]) const {
+    // neighbouring work-items in x read neighbouring pixels, so a row of the work-group spans whole
+    // simd units of the device. Devices that only emulate local memory gain nothing from tall groups.
+    size_t multiple;
+    checkStatus(clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE, sizeof(size_t), &multiple, NULL));
+    if (multiple == 0) multiple = 1;
+
+    size_t width = alongAxis == 0 ? roundUp(64, multiple) : roundUp(16, multiple);
+    size_t rows = info.dedicatedLocalMem ? (alongAxis == 0 ? 4 : width) : 1;
+    localWorkSize[0] = width;
+    localWorkSize[1] = rows;
+    fitWorkGroup(kernel, localWorkSize);
+}
+
+void BlurEngine::fitWorkGroup(cl_kernel kernel, size_t localWorkSize[2]) const {
+    size_t kernelWorkGroupSize;
+    checkStatus(clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &kernelWorkGroupSize, NULL));
+    size_t limit = kernelWorkGroupSize < info.maxWorkGroupSize ? kernelWorkGroupSize : info.maxWorkGroupSize;
+
+    // shrink the preferred shape until the device accepts it, the taller side is halved first
+    while (localWorkSize[0] * localWorkSize[1] > limit || localWorkSize[0] > info.maxWorkItemSizes[0] || localWorkSize[1] > info.maxWorkItemSizes[1]) {
+        if (localWorkSize[1] > 1 && (localWorkSize[1] >= localWorkSize[0] || localWorkSize[1] > info.maxWorkItemSizes[1]))
+            localWorkSize[1] /= 2;
+        else
+            localWorkSize[0] /= 2;
+    }
+}
+
+static size_t tileBytes(const PassLaunch& launch, int alongAxis, int radius) {
+    size_t along = launch.localWorkSize[alongAxis];
+    size_t across = launch.localWorkSize[1 - alongAxis];
+    return (along * launch.pixelsPerItem + 2 * radius) * across * localPixelSize;
+}
+
+int BlurEngine::fitTile(size_t localWorkSize[2], int alongAxis, int radius) const {
+    int acrossAxis = 1 - alongAxis;
+    size_t along = localWorkSize[alongAxis];
+
+    // a tile that is about twice as long as the halo keeps the redundant halo loads below 50%
+    PassLaunch launch;
+    launch.localWorkSize[0] = localWorkSize[0];
+    launch.localWorkSize[1] = localWorkSize[1];
+    launch.pixelsPerItem = (int)((2 * radius + along - 1) / along);
+    if (launch.pixelsPerItem < 1) launch.pixelsPerItem = 1;
+    if (launch.pixelsPerItem > maxPixelsPerItem) launch.pixelsPerItem = maxPixelsPerItem;
+
+    // give up tile length first and then tile width until the tile fits into local memory
+    while (tileBytes(launch, alongAxis, radius) > info.localMemSize && launch.pixelsPerItem > 1)
+        launch.pixelsPerItem--;
+    while (tileBytes(launch, alongAxis, radius) > info.localMemSize && launch.localWorkSize[acrossAxis] > 1)
+        launch.localWorkSize[acrossAxis] /= 2;
+
+    if (tileBytes(launch, alongAxis, radius) > info.localMemSize) {
+        printf("Error: Kernel size %d does not fit into the local memory of the device!\n", 2 * radius + 1);
+        exit(EXIT_FAILURE);
+    }
+
+    localWorkSize[acrossAxis] = launch.localWorkSize[acrossAxis];
+    return launch.pixelsPerItem;
+}
+
+bool BlurEngine::fitsDevice(cl_kernel kernel, const PassLaunch& launch, int alongAxis, int radius) const {
+    size_t kernelWorkGroupSize;
+    checkStatus(clGetKernelWorkGroupInfo(kernel, device, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &kernelWorkGroupSize, NULL));
+
+    return launch.pixelsPerItem >= 1
+        && launch.localWorkSize[0] >= 1 && launch.localWorkSize[1] >= 1
+        && launch.localWorkSize[0] * launch.localWorkSize[1] <= kernelWorkGroupSize
+        && launch.localWorkSize[0] * launch.localWorkSize[1] <= info.maxWorkGroupSize
+        && launch.localWorkSize[0] <= info.maxWorkItemSizes[0]
+        && launch.localWorkSize[1] <= info.maxWorkItemSizes[1]
+        && tileBytes(launch, alongAxis, radius) <= info.localMemSize;
+}
+
+PassLaunch BlurEngine::heuristicLaunch(cl_kernel kernel, int alongAxis, int radius) const {
+    PassLaunch launch;
+    preferredWorkGroup(kernel, alongAxis, launch.localWorkSize);
+    launch.pixelsPerItem = fitTile(launch.localWorkSize, alongAxis, radius);
+    return launch;
+}
+
+TuningKey BlurEngine::tuningKey(int kernelSize, Precision precision, int channels) const {
+    TuningKey key;
+    key.device = info.platformName + " / " + info.name + " / " + info.driverVersion;
+    key.kernelSize = kernelSize;
+    key.precision = precisionName(precision);
+    key.channels = channels;
+    key.verticalPass = verticalPassName(verticalPass);
+    return key;
+}
+
+void BlurEngine::selectLaunch(const BlurProgram& blurProgram, int kernelSize, Precision precision, int channels, PassLaunch& horizontal, PassLaunch& vertical) const {
+    int radius = kernelSize / 2;
+
+    // the transposed vertical pass blurs the columns as rows of the transposed image
+    cl_kernel verticalKernel = verticalPass == VerticalPass::Transposed ? blurProgram.transposedKernel : blurProgram.verticalKernel;
+    int verticalAxis = verticalPass == VerticalPass::Transposed ? 0 : 1;
+
+    // an autotuned launch wins as long as the kernel still accepts it, the driver may have changed the limits
+    TunedLaunch tuned;
+    if (tuning.find(tuningKey(kernelSize, precision, channels), tuned)
+        && fitsDevice(blurProgram.horizontalKernel, tuned.horizontal, 0, radius)
+        && fitsDevice(verticalKernel, tuned.vertical, verticalAxis, radius)) {
+        horizontal = tuned.horizontal;
+        vertical = tuned.vertical;
+        return;
+    }
+
+    // rows are processed in wide tiles and columns in square tiles, both with a halo of radius pixels
+    horizontal = heuristicLaunch(blurProgram.horizontalKernel, 0, radius);
+    vertical = heuristicLaunch(verticalKernel, verticalAxis, radius);
+}
+
+void BlurEngine::enqueuePass(cl_command_queue commandQueue, cl_kernel kernel, cl_mem input, cl_mem output, int width, int height, int kernelSize, cl_mem weights, const PassLaunch& launch, int alongAxis) {
+    cl_int radius = kernelSize / 2;
+    cl_int pixelsPerItem = launch.pixelsPerItem;
+    size_t tileSize = tileBytes(launch, alongAxis, radius);
+
+    // setting the kernel arguments
+    checkStatus(clSetKernelArg(kernel, 0, sizeof(cl_mem), &input));
+    checkStatus(clSetKernelArg(kernel, 1, sizeof(cl_mem), &output));
+    checkStatus(clSetKernelArg(kernel, 2, sizeof(cl_int), &width));
+    checkStatus(clSetKernelArg(kernel, 3, sizeof(cl_int), &height));
+    checkStatus(clSetKernelArg(kernel, 4, sizeof(cl_int), &kernelSize));
+    checkStatus(clSetKernelArg(kernel, 5, sizeof(cl_int), &pixelsPerItem));
+    checkStatus(clSetKernelArg(kernel, 6, sizeof(cl_mem), &weights));
+    checkStatus(clSetKernelArg(kernel, 7, tileSize, NULL));
+
+    // every work-item covers pixelsPerItem pixels along the pass and one pixel across it
+    size_t size[2] = { (size_t)width, (size_t)height };
+    size_t globalWorkSize[2];
+    globalWorkSize[alongAxis] = divideRoundUp(size[alongAxis], launch.localWorkSize[alongAxis] * pixelsPerItem) * launch.localWorkSize[alongAxis];
+    globalWorkSize[1 - alongAxis] = roundUp(size[1 - alongAxis], launch.localWorkSize[1 - alongAxis]);
+    checkStatus(clEnqueueNDRangeKernel(commandQueue, kernel, 2, NULL, globalWorkSize, launch.localWorkSize, 0, NULL, NULL));
+}
+
+void BlurEngine::enqueueTranspose(cl_command_queue commandQueue, cl_kernel kernel, cl_mem input, cl_mem output, int width, int height) {
+    // the tile has to be square, one padding pixel per tile row avoids bank conflicts
+    size_t localWorkSize[2] = { 16, 16 };
+    fitWorkGroup(kernel, localWorkSize);
+    localWorkSize[0] = localWorkSize[1] = localWorkSize[0] < localWorkSize[1] ? localWorkSize[0] : localWorkSize[1];
+    size_t tileSize = localWorkSize[0] * (localWorkSize[0] + 1) * localPixelSize;
+
+    checkStatus(clSetKernelArg(kernel, 0, sizeof(cl_mem), &input));
+    checkStatus(clSetKernelArg(kernel, 1, sizeof(cl_mem), &output));
+    checkStatus(clSetKernelArg(kernel, 2, sizeof(cl_int), &width));
+    checkStatus(clSetKernelArg(kernel, 3, sizeof(cl_int), &height));
+    checkStatus(clSetKernelArg(kernel, 4, tileSize, NULL));
+
+    size_t globalWorkSize[2] = { roundUp(width, localWorkSize[0]), roundUp(height, localWorkSize[1]) };
+    checkStatus(clEnqueueNDRangeKernel(commandQueue, kernel, 2, NULL, globalWorkSize, localWorkSize, 0, NULL, NULL));
+}
+
+void BlurEngine::enqueueBlur(cl_command_queue commandQueue, const BlurProgram& blurProgram, Slot& slot, cl_mem image, int width, int height, int kernelSize, cl_mem weights,
+                             const PassLaunch& horizontal, const PassLaunch& vertical) {
+    // the in-order queue takes care of the dependencies between the upload and the passes
+    enqueuePass(commandQueue, blurProgram.horizontalKernel, image, slot.bufferTemp, width, height, kernelSize, weights, horizontal, 0);
+
+    if (verticalPass == VerticalPass::Direct) {
+        enqueuePass(commandQueue, blurProgram.verticalKernel, slot.bufferTemp, image, width, height, kernelSize, weights, vertical, 1);
+        return;
+    }
+
+    // the columns become rows of a height x width image, the row pass blurs them with the vertical launch
+    enqueueTranspose(commandQueue, blurProgram.transposeKernel, slot.bufferTemp, slot.bufferTransposed, width, height);
+    enqueuePass(commandQueue, blurProgram.transposedKernel, slot.bufferTransposed, slot.bufferTemp, height, width, kernelSize, weights, vertical, 0);
+    enqueueTranspose(commandQueue, blurProgram.transposeKernel, slot.bufferTemp, image, height, width);
+}
+
+// the iir arguments are vectors of the accumulation type of gauss.cl, double or float
+template <typename Vector>
+static void setIirArguments(cl_kernel kernel, Vector, const double coefficients[4], const double boundary[9]) {
+    Vector values[4] = {};
+    for (int i = 0; i < 4; i++)
+        values[0].s[i] = coefficients[i];
+    for (int k = 0; k < 3; k++)
+        for (int j = 0; j < 3; j++)
+            values[1 + k].s[j] = boundary[k * 3 + j];
+    for (int i = 0; i < 4; i++)
+        checkStatus(clSetKernelArg(kernel, 6 + i, sizeof(Vector), &values[i]));
+}
+
+void BlurEngine::enqueueLineFilter(cl_command_queue commandQueue, const BlurProgram& blurProgram, Slot& slot, cl_mem image, int width, int height, double sigma, BlurMethod method, Precision precision) {
+    cl_kernel kernel = method == BlurMethod::Box3 ? blurProgram.boxKernel : blurProgram.iirKernel;
+
+    // the box kernel takes the ring as an extra argument in front of the sizes
+    int argument = 0;
+    if (method == BlurMethod::Box3) {
+        int radii[3];
+        _box_blur_radii(sigma, 3, radii);
+        for (int i = 0; i < 3; i++)
+            checkStatus(clSetKernelArg(kernel, 7 + i, sizeof(cl_int), &radii[i]));
+        checkStatus(clSetKernelArg(kernel, 3, sizeof(cl_mem), &slot.bufferRing));
+        argument = 1;
+    } else {
+        double coefficients[4], boundary[9];
+        _iir_blur_coefficients(sigma, coefficients, boundary);
+        if (precision == Precision::Double)
+            setIirArguments(kernel, cl_double4(), coefficients, boundary);
+        else
+            setIirArguments(kernel, cl_float4(), coefficients, boundary);
+    }
+
+    // One work-item per column, so the loads and stores of neighbouring work-items are coalesced.
+    // The rows are filtered as the columns of the transposed image, which is transposed back
+    // before its columns are filtered.
+    auto filterColumns = [&](cl_mem input, cl_mem output, int columns, int rows, cl_int sourcePass) {
+        checkStatus(clSetKernelArg(kernel, 0, sizeof(cl_mem), &input));
+        checkStatus(clSetKernelArg(kernel, 1, sizeof(cl_mem), &output));
+        checkStatus(clSetKernelArg(kernel, 2, sizeof(cl_mem), &slot.bufferLines));
+        checkStatus(clSetKernelArg(kernel, 3 + argument, sizeof(cl_int), &columns));
+        checkStatus(clSetKernelArg(kernel, 4 + argument, sizeof(cl_int), &rows));
+        checkStatus(clSetKernelArg(kernel, 5 + argument, sizeof(cl_int), &sourcePass));
+
+        size_t globalWorkSize = columns;
+        checkStatus(clEnqueueNDRangeKernel(commandQueue, kernel, 1, NULL, &globalWorkSize, NULL, 0, NULL, NULL));
+    };
+
+    enqueueTranspose(commandQueue, blurProgram.transposeKernel, image, slot.bufferTransposed, width, height);
+    filterColumns(slot.bufferTransposed, slot.bufferTemp, height, width, 1);
+    enqueueTranspose(commandQueue, blurProgram.transposeKernel, slot.bufferTemp, slot.bufferTransposed, height, width);
+    filterColumns(slot.bufferTransposed, image, width, height, 0);
+}
+
+const BlurEngine::BlurProgram& BlurEngine::selectProgram(cl_command_queue commandQueue, int kernelSize, double sigma, Precision precision, int channels, cl_mem& weights) {
+    // usual kernels get a program with the weights compiled in, the generic program reads them from
+    // a buffer and falls back to global memory for weights that do not fit into the constant buffer
+    bool constantWeights = weightSize(precision) * kernelSize <= info.maxConstantBufferSize;
+    bool specialized = constantWeights && kernelSize <= maxSpecializedKernelSize;
+
+    // specialized programs ignore the weights argument, a NULL buffer is passed then
+    weights = NULL;
+    if (specialized)
+        return getSpecializedProgram(kernelSize, sigma, precision, channels);
+
+    const BlurProgram& blurProgram = getProgram(buildOptions(precision, constantWeights, channels));
+    uploadBlurKernel(commandQueue, kernelSize, sigma, precision);
+    weights = bufferBlurKernel;
+    return blurProgram;
+}
+
+double BlurEngine::timePass(cl_command_queue commandQueue, cl_kernel kernel, cl_mem input, cl_mem output, int width, int height, int kernelSize, cl_mem weights, const PassLaunch& launch, int alongAxis) {
+    // the first launch pays for caches and lazy allocations, the best of the following ones counts
+    enqueuePass(commandQueue, kernel, input, output, width, height, kernelSize, weights, launch, alongAxis);
+    checkStatus(clFinish(commandQueue));
+
+    double best = 0.0;
+    for (int run = 0; run < autotuneRuns; run++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        enqueuePass(commandQueue, kernel, input, output, width, height, kernelSize, weights, launch, alongAxis);
+        checkStatus(clFinish(commandQueue));
+        auto end = std::chrono::high_resolution_clock::now();
+        double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+        if (run == 0 || milliseconds < best)
+            best = milliseconds;
+    }
+    return best;
+}
+
+TunedLaunch BlurEngine::autotune(const tga::TGAImage& sample, int kernelSize, double sigma, Precision precision) {
+    if (!supportsPrecision(precision)) {
+        printf("Error: The device does not support the requested precision!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // the benchmark needs the device to itself
+    for (int i = 0; i < slotCount(); i++)
+        finish(i);
+    Slot& slot = slots[0];
+
+    int channels = sample.bpp / 8;
+    int radius = kernelSize / 2;
+    int width = (int)sample.width;
+    int height = (int)sample.height;
+    size_t dataSize = (size_t)width * height * channels;
+
+    cl_mem weights;
+    const BlurProgram& blurProgram = selectProgram(slot.commandQueue, kernelSize, sigma, precision, channels, weights);
+    reserveBuffer(slot.bufferImage, slot.imageCapacity, dataSize);
+    reserveBuffer(slot.bufferTemp, slot.tempCapacity, dataSize);
+    checkStatus(clEnqueueWriteBuffer(slot.commandQueue, slot.bufferImage, CL_TRUE, 0, dataSize, sample.data(), 0, NULL, NULL));
+
+    // the transposed vertical pass runs the row kernel on the height x width transposed image
+    bool transposed = verticalPass == VerticalPass::Transposed;
+    if (transposed)
+        reserveBuffer(slot.bufferTransposed, slot.transposedCapacity, dataSize);
+
+    // both passes are tuned on their own, every power of two shape the device accepts is a candidate
+    TunedLaunch tuned;
+    for (int pass = 0; pass < 2; pass++) {
+        int alongAxis = pass == 0 || transposed ? 0 : 1;
+        int passWidth = pass == 1 && transposed ? height : width;
+        int passHeight = pass == 1 && transposed ? width : height;
+        cl_kernel kernel = pass == 0 ? blurProgram.horizontalKernel : transposed ? blurProgram.transposedKernel : blurProgram.verticalKernel;
+        cl_mem input = pass == 0 ? slot.bufferImage : transposed ? slot.bufferTransposed : slot.bufferTemp;
+        cl_mem output = pass == 0 ? slot.bufferTemp : transposed ? slot.bufferTemp : slot.bufferImage;
+
+        // the transposed pass reads the transposed result of the row pass, like in enqueueBlur
+        if (pass == 1 && transposed)
+            enqueueTranspose(slot.commandQueue, blurProgram.transposeKernel, slot.bufferTemp, slot.bufferTransposed, width, height);
+
+        PassLaunch fastest = heuristicLaunch(kernel, alongAxis, radius);
+        double fastestTime = timePass(slot.commandQueue, kernel, input, output, passWidth, passHeight, kernelSize, weights, fastest, alongAxis);
+
+        for (size_t x = 1; x <= info.maxWorkItemSizes[0] && x <= maxAutotuneWorkGroupSize; x *= 2) {
+            for (size_t y = 1; y <= info.maxWorkItemSizes[1] && x * y <= maxAutotuneWorkGroupSize; y *= 2) {
+                for (int pixelsPerItem = 1; pixelsPerItem <= maxPixelsPerItem; pixelsPerItem *= 2) {
+                    PassLaunch candidate;
+                    candidate.localWorkSize[0] = x;
+                    candidate.localWorkSize[1] = y;
+                    candidate.pixelsPerItem = pixelsPerItem;
+                    if (!fitsDevice(kernel, candidate, alongAxis, radius))
+                        continue;
+
+                    double milliseconds = timePass(slot.commandQueue, kernel, input, output, passWidth, passHeight, kernelSize, weights, candidate, alongAxis);
+                    if (milliseconds < fastestTime) {
+                        fastest = candidate;
+                        fastestTime = milliseconds;
+                    }
+                }
+            }
+        }
+
+        if (pass == 0)
+            tuned.horizontal = fastest;
+        else
+            tuned.vertical = fastest;
+        tuned.milliseconds += fastestTime;
+    }
+
+    tuning.store(tuningKey(kernelSize, precision, channels), tuned);
+    if (!tuning.save())
+        printf("Warning: Could not write the tuning database!\n");
+
+    return tuned;
+}
+
+void BlurEngine::blurAsync(int slotIndex, tga::TGAImage& image, int kernelSize, double sigma, Precision precision, BlurMethod method) {
+    if (!supportsPrecision(precision)) {
+        printf("Error: The device does not support the requested precision!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // the slot may still hold the previous image
+    finish(slotIndex);
+    Slot& slot = slots[slotIndex];
+
+    int channels = image.bpp / 8;
+    size_t dataSize = sizeof(unsigned char) * (size_t)image.height * (size_t)image.width * channels;
+
+    // The line filters need no weights. They keep one plane of double or float vectors, which is
+    // double for the iir method on every device that supports it. The ring of the box method
+    // holds the last radius + 1 pixels of every column of both passes.
+    bool lineFilter = method != BlurMethod::Exact;
+    Precision linePrecision = method == BlurMethod::Iir && supportsPrecision(Precision::Double) ? Precision::Double : precision;
+    size_t lineValueSize = 4 * (linePrecision == Precision::Double ? sizeof(cl_double) : sizeof(cl_float));
+    size_t linesSize = (size_t)image.height * (size_t)image.width * lineValueSize;
+    size_t ringSize = 0;
+    if (method == BlurMethod::Box3) {
+        int radii[3];
+        _box_blur_radii(sigma, 3, radii);
+        size_t slots = (size_t)std::max(radii[0], std::max(radii[1], radii[2])) + 1;
+        ringSize = std::max(std::min<size_t>(slots, image.width) * image.height, std::min<size_t>(slots, image.height) * image.width) * lineValueSize;
+    }
+
+    cl_mem weights = NULL;
+    const BlurProgram& blurProgram = lineFilter ? getProgram(buildOptions(linePrecision, true, channels))
+                                                : selectProgram(slot.commandQueue, kernelSize, sigma, precision, channels, weights);
+    PassLaunch horizontal, vertical;
+    if (!lineFilter)
+        selectLaunch(blurProgram, kernelSize, precision, channels, horizontal, vertical);
+
+    if (dataSize > info.maxMemAllocSize || (lineFilter && linesSize > info.maxMemAllocSize)) {
+        printf("Error: The image needs %zu bytes but the device allocates at most %llu bytes per buffer!\n", lineFilter ? linesSize : dataSize, (unsigned long long)info.maxMemAllocSize);
+        exit(EXIT_FAILURE);
+    }
+
+    cl_int status;
+    reserveBuffer(slot.bufferTemp, slot.tempCapacity, dataSize);
+    if (lineFilter)
+        reserveBuffer(slot.bufferLines, slot.linesCapacity, linesSize);
+    if (ringSize > 0)
+        reserveBuffer(slot.bufferRing, slot.ringCapacity, ringSize);
+    if (lineFilter || verticalPass == VerticalPass::Transposed)
+        reserveBuffer(slot.bufferTransposed, slot.transposedCapacity, dataSize);
+
+    // the passes are the same for both ways of getting the image to the device
+    auto enqueue = [&](cl_mem deviceImage) {
+        if (lineFilter)
+            enqueueLineFilter(slot.commandQueue, blurProgram, slot, deviceImage, (int)image.width, (int)image.height, sigma, method, linePrecision);
+        else
+            enqueueBlur(slot.commandQueue, blurProgram, slot, deviceImage, (int)image.width, (int)image.height, kernelSize, weights, horizontal, vertical);
+    };
+
+    // Pixels that are not page aligned, like those behind the header of a mapped tga, would be
+    // copied by most drivers behind CL_MEM_USE_HOST_PTR anyway, they are uploaded and read back.
+    bool useHostPointer = zeroCopy && reinterpret_cast<uintptr_t>(image.data()) % tga::ImageData::allocator_type::alignment == 0;
+
+    if (useHostPointer) {
+        // the device works on the tga data in place, mapping the buffer afterwards makes the result visible to the host
+        slot.hostImage = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, dataSize, image.data(), &status);
+        checkStatus(status);
+
+        enqueue(slot.hostImage);
+
+        slot.mappedImage = clEnqueueMapBuffer(slot.commandQueue, slot.hostImage, CL_FALSE, CL_MAP_READ, 0, dataSize, 0, NULL, &slot.done, &status);
+        checkStatus(status);
+    } else {
+        reserveBuffer(slot.bufferImage, slot.imageCapacity, dataSize);
+
+        // the kernels read the interleaved tga data directly
+        checkStatus(clEnqueueWriteBuffer(slot.commandQueue, slot.bufferImage, CL_FALSE, 0, dataSize, image.data(), 0, NULL, NULL));
+
+        enqueue(slot.bufferImage);
+
+        // read the result of the program straight back into the tga image
+        checkStatus(clEnqueueReadBuffer(slot.commandQueue, slot.bufferImage, CL_FALSE, 0, dataSize, image.data(), 0, NULL, &slot.done));
+    }
+
+    // hand the commands to the device now, nobody waits on this queue until finish
+    checkStatus(clFlush(slot.commandQueue));
+}
+
+void BlurEngine::finish(int slotIndex) {
+    Slot& slot = slots[slotIndex];
+    if (!slot.done)
+        return;
+
+    checkStatus(clWaitForEvents(1, &slot.done));
+    checkStatus(clReleaseEvent(slot.done));
+    slot.done = NULL;
+
+    if (slot.hostImage) {
+        checkStatus(clEnqueueUnmapMemObject(slot.commandQueue, slot.hostImage, slot.mappedImage, 0, NULL, NULL));
+        checkStatus(clFinish(slot.commandQueue));
+        checkStatus(clReleaseMemObject(slot.hostImage));
+        slot.hostImage = NULL;
+        slot.mappedImage = NULL;
+    }
+}
+
+cl_mem BlurEngine::enqueueDirectConvolution(cl_command_queue commandQueue, const BlurProgram& blurProgram, Slot& slot, int width, int height, const Kernel2D& kernel, Precision precision) {
+    // the weights in the accumulation type of gauss.cl, the write blocks so the vector can go
+    size_t weightsSize = kernel.weights.size() * (precision == Precision::Double ? sizeof(cl_double) : sizeof(cl_float));
+    reserveBuffer(bufferConvolution, convolutionCapacity, weightsSize);
+    if (precision == Precision::Double) {
+        checkStatus(clEnqueueWriteBuffer(commandQueue, bufferConvolution, CL_TRUE, 0, weightsSize, kernel.weights.data(), 0, NULL, NULL));
+    } else {
+        std::vector<cl_float> weights(kernel.weights.begin(), kernel.weights.end());
+        checkStatus(clEnqueueWriteBuffer(commandQueue, bufferConvolution, CL_TRUE, 0, weightsSize, weights.data(), 0, NULL, NULL));
+    }
+
+    cl_kernel convolveKernel = blurProgram.convolveKernel;
+    checkStatus(clSetKernelArg(convolveKernel, 0, sizeof(cl_mem), &slot.bufferImage));
+    checkStatus(clSetKernelArg(convolveKernel, 1, sizeof(cl_mem), &slot.bufferTemp));
+    checkStatus(clSetKernelArg(convolveKernel, 2, sizeof(cl_mem), &bufferConvolution));
+    checkStatus(clSetKernelArg(convolveKernel, 3, sizeof(cl_int), &width));
+    checkStatus(clSetKernelArg(convolveKernel, 4, sizeof(cl_int), &height));
+    checkStatus(clSetKernelArg(convolveKernel, 5, sizeof(cl_int), &kernel.width));
+    checkStatus(clSetKernelArg(convolveKernel, 6, sizeof(cl_int), &kernel.height));
+
+    size_t globalWorkSize[2] = { (size_t)width, (size_t)height };
+    checkStatus(clEnqueueNDRangeKernel(commandQueue, convolveKernel, 2, NULL, globalWorkSize, NULL, 0, NULL, NULL));
+    return slot.bufferTemp;
+}
+
+cl_mem BlurEngine::enqueueFftConvolution(cl_command_queue commandQueue, const BlurProgram& blurProgram, Slot& slot, int width, int height, const Kernel2D& kernel,
+                                         const ConvolutionPlan& plan, Precision precision) {
+    size_t valueSize = precision == Precision::Double ? sizeof(cl_double) : sizeof(cl_float);
+    int fftSize = plan.fftSize;
+    int tileSize = plan.tileSize;
+    int tilesX = (int)divideRoundUp(width + kernel.width - 1, tileSize);
+    int tilesY = (int)divideRoundUp(height + kernel.height - 1, tileSize);
+    int area = fftSize * fftSize;
+    int logSize = 0;
+    while ((1 << logSize) < fftSize)
+        logSize++;
+
+    // the result plane holds four channels, the tiles of a group of tile rows two
+    size_t resultSize = (size_t)width * height * 4 * valueSize;
+    size_t tileRowSize = (size_t)tilesX * area * 2 * valueSize;
+    int tileRows = (int)std::min<size_t>(tilesY, info.maxMemAllocSize / tileRowSize);
+    if (resultSize > info.maxMemAllocSize || tileRows < 1) {
+        printf("Error: The convolution needs %zu bytes but the device allocates at most %llu bytes per buffer!\n", std::max(resultSize, tileRowSize), (unsigned long long)info.maxMemAllocSize);
+        exit(EXIT_FAILURE);
+    }
+    reserveBuffer(slot.bufferLines, slot.linesCapacity, resultSize);
+    reserveBuffer(slot.bufferTemp, slot.tempCapacity, tileRows * tileRowSize);
+
+    size_t spectrumSize = (size_t)area * 2 * valueSize;
+    reserveBuffer(bufferConvolution, convolutionCapacity, spectrumSize);
+    if (precision == Precision::Double) {
+        std::vector<std::complex<double>> spectrum = kernelSpectrum<double>(kernel, fftSize);
+        checkStatus(clEnqueueWriteBuffer(commandQueue, bufferConvolution, CL_TRUE, 0, spectrumSize, spectrum.data(), 0, NULL, NULL));
+    } else {
+        std::vector<std::complex<float>> spectrum = kernelSpectrum<float>(kernel, fftSize);
+        checkStatus(clEnqueueWriteBuffer(commandQueue, bufferConvolution, CL_TRUE, 0, spectrumSize, spectrum.data(), 0, NULL, NULL));
+    }
+
+    // the arguments that stay the same for every group
+    cl_kernel loadKernel = blurProgram.fftLoadKernel;
+    checkStatus(clSetKernelArg(loadKernel, 0, sizeof(cl_mem), &slot.bufferImage));
+    checkStatus(clSetKernelArg(loadKernel, 1, sizeof(cl_mem), &slot.bufferTemp));
+    checkStatus(clSetKernelArg(loadKernel, 2, sizeof(cl_int), &width));
+    checkStatus(clSetKernelArg(loadKernel, 3, sizeof(cl_int), &height));
+    checkStatus(clSetKernelArg(loadKernel, 4, sizeof(cl_int), &kernel.width));
+    checkStatus(clSetKernelArg(loadKernel, 5, sizeof(cl_int), &kernel.height));
+    checkStatus(clSetKernelArg(loadKernel, 6, sizeof(cl_int), &fftSize));
+    checkStatus(clSetKernelArg(loadKernel, 7, sizeof(cl_int), &tileSize));
+    checkStatus(clSetKernelArg(loadKernel, 8, sizeof(cl_int), &tilesX));
+
+    cl_kernel linesKernel = blurProgram.fftLinesKernel;
+    checkStatus(clSetKernelArg(linesKernel, 0, sizeof(cl_mem), &slot.bufferTemp));
+    checkStatus(clSetKernelArg(linesKernel, 1, sizeof(cl_int), &fftSize));
+    checkStatus(clSetKernelArg(linesKernel, 2, sizeof(cl_int), &logSize));
+
+    cl_kernel multiplyKernel = blurProgram.fftMultiplyKernel;
+    checkStatus(clSetKernelArg(multiplyKernel, 0, sizeof(cl_mem), &slot.bufferTemp));
+    checkStatus(clSetKernelArg(multiplyKernel, 1, sizeof(cl_mem), &bufferConvolution));
+    checkStatus(clSetKernelArg(multiplyKernel, 2, sizeof(cl_int), &area));
+
+    cl_kernel accumulateKernel = blurProgram.fftAccumulateKernel;
+    checkStatus(clSetKernelArg(accumulateKernel, 0, sizeof(cl_mem), &slot.bufferTemp));
+    checkStatus(clSetKernelArg(accumulateKernel, 1, sizeof(cl_mem), &slot.bufferLines));
+    checkStatus(clSetKernelArg(accumulateKernel, 2, sizeof(cl_int), &width));
+    checkStatus(clSetKernelArg(accumulateKernel, 3, sizeof(cl_int), &height));
+    checkStatus(clSetKernelArg(accumulateKernel, 4, sizeof(cl_int), &kernel.width));
+    checkStatus(clSetKernelArg(accumulateKernel, 5, sizeof(cl_int), &kernel.height));
+    checkStatus(clSetKernelArg(accumulateKernel, 6, sizeof(cl_int), &fftSize));
+    checkStatus(clSetKernelArg(accumulateKernel, 7, sizeof(cl_int), &tileSize));
+    checkStatus(clSetKernelArg(accumulateKernel, 8, sizeof(cl_int), &tilesX));
+
+    // RGB pads the blue channel with a zero, so both layouts are two channel pairs
+    size_t imageSize[2] = { (size_t)width, (size_t)height };
+    for (cl_int upperPair = 0; upperPair < 2; upperPair++) {
+        for (cl_int firstTileRow = 0; firstTileRow < tilesY; firstTileRow += tileRows) {
+            cl_int groupRows = std::min(tileRows, tilesY - firstTileRow);
+            cl_int clear = firstTileRow == 0;
+            size_t tileCount = (size_t)groupRows * tilesX;
+
+            checkStatus(clSetKernelArg(loadKernel, 9, sizeof(cl_int), &firstTileRow));
+            checkStatus(clSetKernelArg(loadKernel, 10, sizeof(cl_int), &upperPair));
+            size_t loadSize[3] = { (size_t)fftSize, (size_t)fftSize, tileCount };
+            checkStatus(clEnqueueNDRangeKernel(commandQueue, loadKernel, 3, NULL, loadSize, NULL, 0, NULL, NULL));
+
+            // rows and columns forward, the product with the kernel spectrum, and both back
+            size_t linesSize[2] = { (size_t)fftSize, tileCount };
+            size_t multiplySize[2] = { (size_t)area, tileCount };
+            for (cl_int inverse = 0; inverse < 2; inverse++) {
+                if (inverse)
+                    checkStatus(clEnqueueNDRangeKernel(commandQueue, multiplyKernel, 2, NULL, multiplySize, NULL, 0, NULL, NULL));
+                for (cl_int alongAxis = 0; alongAxis < 2; alongAxis++) {
+                    checkStatus(clSetKernelArg(linesKernel, 3, sizeof(cl_int), &alongAxis));
+                    checkStatus(clSetKernelArg(linesKernel, 4, sizeof(cl_int), &inverse));
+                    checkStatus(clEnqueueNDRangeKernel(commandQueue, linesKernel, 2, NULL, linesSize, NULL, 0, NULL, NULL));
+                }
+            }
+
+            checkStatus(clSetKernelArg(accumulateKernel, 9, sizeof(cl_int), &firstTileRow));
+            checkStatus(clSetKernelArg(accumulateKernel, 10, sizeof(cl_int), &groupRows));
+            checkStatus(clSetKernelArg(accumulateKernel, 11, sizeof(cl_int), &upperPair));
+            checkStatus(clSetKernelArg(accumulateKernel, 12, sizeof(cl_int), &clear));
+            checkStatus(clEnqueueNDRangeKernel(commandQueue, accumulateKernel, 2, NULL, imageSize, NULL, 0, NULL, NULL));
+        }
+    }
+
+    cl_kernel storeKernel = blurProgram.convolveStoreKernel;
+    checkStatus(clSetKernelArg(storeKernel, 0, sizeof(cl_mem), &slot.bufferLines));
+    checkStatus(clSetKernelArg(storeKernel, 1, sizeof(cl_mem), &slot.bufferImage));
+    checkStatus(clSetKernelArg(storeKernel, 2, sizeof(cl_int), &width));
+    checkStatus(clSetKernelArg(storeKernel, 3, sizeof(cl_int), &height));
+    size_t pixelCount = (size_t)width * height;
+    checkStatus(clEnqueueNDRangeKernel(commandQueue, storeKernel, 1, NULL, &pixelCount, NULL, 0, NULL, NULL));
+    return slot.bufferImage;
+}
+
+void BlurEngine::convolve(tga::TGAImage& image, const Kernel2D& kernel, const ConvolutionPlan& plan, Precision precision) {
+    if (!supportsPrecision(precision)) {
+        printf("Error: The device does not support the requested precision!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < slotCount(); i++)
+        finish(i);
+    Slot& slot = slots[0];
+
+    if (precision == Precision::Half || precision == Precision::Fixed)
+        precision = Precision::Float;
+
+    int channels = image.bpp / 8;
+    int width = (int)image.width;
+    int height = (int)image.height;
+    size_t dataSize = (size_t)width * height * channels;
+    if (dataSize > info.maxMemAllocSize) {
+        printf("Error: The image needs %zu bytes but the device allocates at most %llu bytes per buffer!\n", dataSize, (unsigned long long)info.maxMemAllocSize);
+        exit(EXIT_FAILURE);
+    }
+
+    const BlurProgram& blurProgram = getProgram(buildOptions(precision, true, channels));
+    reserveBuffer(slot.bufferImage, slot.imageCapacity, dataSize);
+    reserveBuffer(slot.bufferTemp, slot.tempCapacity, dataSize);
+    checkStatus(clEnqueueWriteBuffer(slot.commandQueue, slot.bufferImage, CL_FALSE, 0, dataSize, image.data(), 0, NULL, NULL));
+
+    cl_mem result = plan.algorithm == ConvolutionAlgorithm::Fft
+        ? enqueueFftConvolution(slot.commandQueue, blurProgram, slot, width, height, kernel, plan, precision)
+        : enqueueDirectConvolution(slot.commandQueue, blurProgram, slot, width, height, kernel, precision);
+
+    checkStatus(clEnqueueReadBuffer(slot.commandQueue, result, CL_TRUE, 0, dataSize, image.data(), 0, NULL, NULL));
+}
@@ -0,0 +1,180 @@
+#ifndef GAUSSIAN_BLUR_BLUR_ENGINE_H
+#define GAUSSIAN_BLUR_BLUR_ENGINE_H
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "tga.h"
+#include "blur_backend.h"
+#include "cl_utils.h"
+#include "program_cache.h"
+#include "device_info.h"
+#include "tuning_database.h"
+
+
+// how image data gets to the device. Zero copy wraps the page aligned tga data in a
+// CL_MEM_USE_HOST_PTR buffer and maps it, which avoids both copies on devices that share
+// memory with the host. Auto picks zero copy when CL_DEVICE_HOST_UNIFIED_MEMORY is set.
+// Images whose data is not page aligned, like a memory mapped tga, are copied either way.
+enum class HostMemory {
+    Auto,
+    Copy,
+    ZeroCopy
+};
+
+// settings that are fixed for the lifetime of an engine
+struct EngineOptions {
+    // gauss.cl is embedded into the executable, a file name overrides it during development
+    std::string kernelFileName;
+    // directory for built program binaries, empty disables the cache
+    std::string programCacheDirectory;
+    HostMemory hostMemory = HostMemory::Auto;
+    // number of images that can be on the device at the same time, see blurAsync
+    int inFlightImages = 2;
+    // the engine runs on this device of this platform, both counted from zero
+    int platformIndex = 0;
+    int deviceIndex = 0;
+    // launch configurations found by autotune, loaded at startup and extended by autotune
+    std::string tuningFile;
+    VerticalPass verticalPass = VerticalPass::Direct;
+};
+
+// The OpenCL backend. Owns the OpenCL context, command queue and compiled blur program so that many images
+// can be blurred one after another without paying the device setup and JIT cost again.
+// Device buffers only grow, so a steady stream of equally sized images reuses them.
+// An engine must only be driven from one thread at a time.
+class BlurEngine : public BlurBackend {
+public:
+    explicit BlurEngine(const EngineOptions& options = EngineOptions());
+    ~BlurEngine() override;
+
+    BlurEngine(const BlurEngine&) = delete;
+    BlurEngine& operator=(const BlurEngine&) = delete;
+
+    // Starts blurring the image on one of the in-flight slots and returns without waiting. The
+    // image has to stay alive and untouched until finish has been called for the same slot.
+    // Every slot has its own command queue, so the transfers of one image overlap the kernels of another.
+    void blurAsync(int slot, tga::TGAImage& image, int kernelSize, double sigma, Precision precision = Precision::Float, BlurMethod method = BlurMethod::Exact) override;
+
+    // blocks until the image started on the slot has been blurred and written back
+    void finish(int slot) override;
+
+    // Waits for the images in flight and convolves on the buffers of the first slot, always
+    // through copies. Fft processes as many rows of tiles at once as fit into one allocation.
+    // Half and fixed precision convolve in float, the spectrum of a tile needs more than 11 bits.
+    void convolve(tga::TGAImage& image, const Kernel2D& kernel, const ConvolutionPlan& plan, Precision precision = Precision::Float) override;
+
+    int slotCount() const override { return (int)slots.size(); }
+
+    // double needs cl_khr_fp64 and half needs cl_khr_fp16
+    bool supportsPrecision(Precision precision) const override;
+
+    // half where the device computes it natively, float everywhere else
+    Precision preferredPrecision() const override;
+
+    bool usesZeroCopy() const override { return zeroCopy; }
+
+    // Benchmarks the work-group shapes and pixels per work-item of both passes on the sample image,
+    // stores the fastest launch in the tuning file and uses it from then on for these parameters.
+    TunedLaunch autotune(const tga::TGAImage& sample, int kernelSize, double sigma, Precision precision = Precision::Float);
+
+    const std::string& deviceName() const override { return info.name; }
+    const DeviceInfo& deviceInfo() const { return info; }
+
+private:
+    // an image in flight: its command queue, the device buffers which only grow, and the
+    // event of the final read back. In zero copy mode hostImage wraps the tga data instead.
+    struct Slot {
+        cl_command_queue commandQueue = NULL;
+        cl_mem bufferImage = NULL;
+        cl_mem bufferTemp = NULL;
+        cl_mem bufferTransposed = NULL;
+        size_t imageCapacity = 0;
+        size_t tempCapacity = 0;
+        size_t transposedCapacity = 0;
+        // the plane of filtered lines of the box and iir methods, and the ring of the pixels
+        // leaving the running sums of the box method
+        cl_mem bufferLines = NULL;
+        size_t linesCapacity = 0;
+        cl_mem bufferRing = NULL;
+        size_t ringCapacity = 0;
+        cl_mem hostImage = NULL;
+        void* mappedImage = NULL;
+        cl_event done = NULL;
+    };
+
+    // a built variant of gauss.cl together with its pass kernels, the transposed vertical pass
+    // consists of two transposes around a row pass, the box and iir methods and the convolutions
+    // have kernels of their own
+    struct BlurProgram {
+        cl_program program = NULL;
+        cl_kernel horizontalKernel = NULL;
+        cl_kernel verticalKernel = NULL;
+        cl_kernel transposedKernel = NULL;
+        cl_kernel transposeKernel = NULL;
+        cl_kernel boxKernel = NULL;
+        cl_kernel iirKernel = NULL;
+        cl_kernel convolveKernel = NULL;
+        cl_kernel fftLoadKernel = NULL;
+        cl_kernel fftLinesKernel = NULL;
+        cl_kernel fftMultiplyKernel = NULL;
+        cl_kernel fftAccumulateKernel = NULL;
+        cl_kernel convolveStoreKernel = NULL;
+    };
+
+    // the source header is prepended to gauss.cl, specialized programs define their weights there.
+    // A program with a source header only has the kernels of the separable passes, the others are NULL
+    const BlurProgram& getProgram(const std::string& buildOptions, const std::string& sourceHeader = "");
+    const BlurProgram& getSpecializedProgram(int kernelSize, double sigma, Precision precision, int channels);
+    const BlurProgram& selectProgram(cl_command_queue commandQueue, int kernelSize, double sigma, Precision precision, int channels, cl_mem& weights);
+    void reserveBuffer(cl_mem& buffer, size_t& capacity, size_t size);
+    void uploadBlurKernel(cl_command_queue commandQueue, int kernelSize, double sigma, Precision precision);
+    void enqueueBlur(cl_command_queue commandQueue, const BlurProgram& blurProgram, Slot& slot, cl_mem image, int width, int height, int kernelSize, cl_mem weights,
+                     const PassLaunch& horizontal, const PassLaunch& vertical);
+    void enqueueLineFilter(cl_command_queue commandQueue, const BlurProgram& blurProgram, Slot& slot, cl_mem image, int width, int height, double sigma, BlurMethod method, Precision precision);
+    // both return the buffer that holds the convolved image
+    cl_mem enqueueDirectConvolution(cl_command_queue commandQueue, const BlurProgram& blurProgram, Slot& slot, int width, int height, const Kernel2D& kernel, Precision precision);
+    cl_mem enqueueFftConvolution(cl_command_queue commandQueue, const BlurProgram& blurProgram, Slot& slot, int width, int height, const Kernel2D& kernel,
+                                 const ConvolutionPlan& plan, Precision precision);
+    void enqueueTranspose(cl_command_queue commandQueue, cl_kernel kernel, cl_mem input, cl_mem output, int width, int height);
+    void enqueuePass(cl_command_queue commandQueue, cl_kernel kernel, cl_mem input, cl_mem output, int width, int height, int kernelSize, cl_mem weights, const PassLaunch& launch, int alongAxis);
+    double timePass(cl_command_queue commandQueue, cl_kernel kernel, cl_mem input, cl_mem output, int width, int height, int kernelSize, cl_mem weights, const PassLaunch& launch, int alongAxis);
+
+    // the tuned launch for these parameters if there is one, the heuristic shapes otherwise
+    void selectLaunch(const BlurProgram& blurProgram, int kernelSize, Precision precision, int channels, PassLaunch& horizontal, PassLaunch& vertical) const;
+    PassLaunch heuristicLaunch(cl_kernel kernel, int alongAxis, int radius) const;
+    bool fitsDevice(cl_kernel kernel, const PassLaunch& launch, int alongAxis, int radius) const;
+    TuningKey tuningKey(int kernelSize, Precision precision, int channels) const;
+    void preferredWorkGroup(cl_kernel kernel, int alongAxis, size_t localWorkSize[2]) const;
+    void fitWorkGroup(cl_kernel kernel, size_t localWorkSize[2]) const;
+    int fitTile(size_t localWorkSize[2], int alongAxis, int radius) const;
+
+    cl_platform_id platform = NULL;
+    cl_device_id device = NULL;
+    cl_context context = NULL;
+    DeviceInfo info;
+    std::vector<Slot> slots;
+    std::string programSource;
+    ProgramCache programCache;
+    TuningDatabase tuning;
+    std::map<std::string, BlurProgram> programs;
+
+    // programs with the weights baked in, keyed by kernel size, sigma, precision and channels
+    std::map<std::tuple<int, double, Precision, int>, const BlurProgram*> specializedPrograms;
+
+    bool zeroCopy = false;
+    VerticalPass verticalPass = VerticalPass::Direct;
+
+    cl_mem bufferBlurKernel = NULL;
+    size_t blurKernelCapacity = 0;
+    int currentKernelSize = 0;
+    double currentSigma = 0.0;
+    Precision currentPrecision = Precision::Float;
+
+    // the weights or the spectrum of the last 2D convolution kernel
+    cl_mem bufferConvolution = NULL;
+    size_t convolutionCapacity = 0;
+};
+
+#endif //GAUSSIAN_BLUR_BLUR_ENGINE_H
@@ -0,0 +1,13 @@
+#ifndef GAUSSIAN_BLUR_CL_UTILS_H
+#define GAUSSIAN_BLUR_CL_UTILS_H
+
+#include <string>
+#define CL_MINIMUM_OPENCL_VERSION 120
+#define CL_TARGET_OPENCL_VERSION 120
+#include "CL/cl.h"
+
+std::string cl_errorstring(cl_int err);
+void checkStatus(cl_int err);
+void printCompilerError(cl_program program, cl_device_id device);
+
+#endif //GAUSSIAN_BLUR_CL_UTILS_H
@@ -0,0 +1,119 @@
+#include "convolution.h"
+#include <algorithm>
+#include <cmath>
+#include "fft.h"
+#include "gaussian_blur.h"
+#include "tga.h"
+
+// time of a radix-2 butterfly and of loading, multiplying and adding up one tile value,
+// relative to one multiply-add of the direct convolution, which the compiler vectorizes.
+// Measured on the cpu engine, direct and fft break even at about 13x13 on a 1920x1080 image
+static const double butterflyCost = 20.0;
+static const double tileValueCost = 40.0;
+
+// the fft sizes the planner considers
+static const int minFftSize = 8;
+static const int maxFftSize = 4096;
+
+Kernel2D gaussianKernel2D(int kernelSize, double sigma) {
+    Kernel2D kernel;
+    kernel.width = kernelSize;
+    kernel.height = kernelSize;
+
+    double* weights = _2d_blur_kernel(kernelSize, sigma);
+    kernel.weights.assign(weights, weights + (size_t)kernelSize * kernelSize);
+    delete[] weights;
+
+    return kernel;
+}
+
+bool loadKernel2D(Kernel2D& kernel, const std::string& fileName) {
+    tga::TGAImage image;
+    if (!tga::LoadTGA(&image, fileName.c_str()))
+        return false;
+
+    int channels = image.bpp / 8;
+    kernel.width = (int)image.width;
+    kernel.height = (int)image.height;
+    kernel.weights.resize((size_t)kernel.width * kernel.height);
+
+    double sum = 0.0;
+    for (size_t i = 0; i < kernel.weights.size(); i++) {
+        const unsigned char* pixel = &image.imageData[i * channels];
+        kernel.weights[i] = (pixel[0] + pixel[1] + pixel[2]) / 3.0;
+        sum += kernel.weights[i];
+    }
+
+    if (sum <= 0.0) {
+        printf("Error: The kernel %s is black!\n", fileName.c_str());
+        return false;
+    }
+    for (double& weight : kernel.weights)
+        weight /= sum;
+
+    return true;
+}
+
+const char* convolutionAlgorithmName(ConvolutionAlgorithm algorithm) {
+    switch (algorithm) {
+    case ConvolutionAlgorithm::Direct: return "direct";
+    case ConvolutionAlgorithm::Fft:    return "fft";
+    default:                           return "auto";
+    }
+}
+
+ConvolutionPlan planConvolution(const Kernel2D& kernel, int width, int height, ConvolutionAlgorithm algorithm) {
+    ConvolutionPlan plan;
+    int kernelSize = std::max(kernel.width, kernel.height);
+
+    // operations per channel of the whole image, an fft transforms two channels at once
+    double best = 0.0;
+    for (int fftSize = minFftSize; fftSize <= maxFftSize; fftSize *= 2) {
+        int tileSize = fftSize - kernelSize + 1;
+        if (tileSize < kernelSize - 1 || tileSize < 1)
+            continue;
+
+        double tilesX = std::ceil((double)(width + kernel.width - 1) / tileSize);
+        double tilesY = std::ceil((double)(height + kernel.height - 1) / tileSize);
+        double area = (double)fftSize * fftSize;
+        double cost = tilesX * tilesY * (2.0 * butterflyCost * area * std::log2(area) / 2.0 + tileValueCost * area) / 2.0;
+        if (plan.fftSize == 0 || cost < best) {
+            best = cost;
+            plan.fftSize = fftSize;
+            plan.tileSize = tileSize;
+        }
+
+        // larger tiles only pay off while the image still needs more than one of them
+        if (tilesX * tilesY <= 1.0)
+            break;
+    }
+
+    double direct = (double)width * height * kernel.width * kernel.height;
+    if (algorithm == ConvolutionAlgorithm::Direct || plan.fftSize == 0)
+        plan.algorithm = ConvolutionAlgorithm::Direct;
+    else if (algorithm == ConvolutionAlgorithm::Fft)
+        plan.algorithm = ConvolutionAlgorithm::Fft;
+    else
+        plan.algorithm = best < direct ? ConvolutionAlgorithm::Fft : ConvolutionAlgorithm::Direct;
+
+    return plan;
+}
+
+template <typename Real>
+std::vector<std::complex<Real>> kernelSpectrum(const Kernel2D& kernel, int fftSize) {
+    // always transformed in double, float spectra are only rounded once
+    std::vector<std::complex<double>> transformed((size_t)fftSize * fftSize);
+    double scale = 1.0 / ((double)fftSize * fftSize);
+    for (int y = 0; y < kernel.height; y++)
+        for (int x = 0; x < kernel.width; x++)
+            transformed[(size_t)y * fftSize + x] = kernel.weights[(size_t)y * kernel.width + x] * scale;
+
+    FftPlan<double> plan(fftSize);
+    std::vector<std::complex<double>> scratch;
+    plan.transform2d(transformed.data(), scratch, false);
+
+    return std::vector<std::complex<Real>>(transformed.begin(), transformed.end());
+}
+
+template std::vector<std::complex<float>> kernelSpectrum<float>(const Kernel2D& kernel, int fftSize);
+template std::vector<std::complex<double>> kernelSpectrum<double>(const Kernel2D& kernel, int fftSize);
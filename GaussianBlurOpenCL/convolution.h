@@ -0,0 +1,52 @@
+#ifndef GAUSSIAN_BLUR_CONVOLUTION_H
+#define GAUSSIAN_BLUR_CONVOLUTION_H
+
+#include <complex>
+#include <string>
+#include <vector>
+
+// An arbitrary 2D point spread function, weights are row major and sum up to one. The center
+// is at (width / 2, height / 2), so even sizes are shifted by half a pixel to the top left.
+struct Kernel2D {
+    int width = 0;
+    int height = 0;
+    std::vector<double> weights;
+};
+
+// the gaussian of _2d_blur_kernel
+Kernel2D gaussianKernel2D(int kernelSize, double sigma);
+
+// A point spread function from a tga image, a bokeh shape for example. The weight of a pixel
+// is the mean of its color channels, the weights are normalized to sum up to one.
+bool loadKernel2D(Kernel2D& kernel, const std::string& fileName);
+
+// Direct convolution costs kernel area multiply-adds per pixel and channel. Fft convolves
+// size x size tiles by multiplying their spectra with the spectrum of the kernel and adds
+// the overlapping results of neighbouring tiles, the cost does not depend on the kernel area.
+enum class ConvolutionAlgorithm {
+    Auto,
+    Direct,
+    Fft
+};
+
+const char* convolutionAlgorithmName(ConvolutionAlgorithm algorithm);
+
+// How an image is convolved. Fft tiles are fftSize square and cover tileSize x tileSize
+// pixels of the edge padded image each, the remaining fftSize - tileSize is room for the
+// kernel so the cyclic convolution does not wrap around.
+struct ConvolutionPlan {
+    ConvolutionAlgorithm algorithm = ConvolutionAlgorithm::Direct;
+    int fftSize = 0;
+    int tileSize = 0;
+};
+
+// Picks the fft size with the fewest operations per pixel for the image and the kernel and,
+// for auto, fft only where that is fewer operations than the direct convolution.
+// The tiles are at least as large as the kernel, then only tiles next to each other overlap.
+ConvolutionPlan planConvolution(const Kernel2D& kernel, int width, int height, ConvolutionAlgorithm algorithm);
+
+// the spectrum of the kernel on a fftSize x fftSize tile, scaled by the normalization of the inverse transform
+template <typename Real>
+std::vector<std::complex<Real>> kernelSpectrum(const Kernel2D& kernel, int fftSize);
+
+#endif //GAUSSIAN_BLUR_CONVOLUTION_H
@@ -0,0 +1,187 @@
+#include "cpu_convolution.h"
+#include <algorithm>
+#include <complex>
+#include <vector>
+#include "cpu_kernels.h"
+#include "fft.h"
+
+// output rows per direct convolution task
+static const int directRowBlockHeight = 8;
+
+// The image padded by the kernel, pixel (u, v) is the premultiplied image pixel
+// (u - (kernel.width - 1 - kernel.width / 2), v - (kernel.height - 1 - kernel.height / 2)) clamped
+// to the edge. The convolution of the image at (x, y) is then
+// sum over (i, j) of weight(i, j) * padded(x + kernel.width - 1 - i, y + kernel.height - 1 - j).
+// The values are converted to Real once, so the inner loops are plain multiply-adds.
+template <typename Real>
+struct PaddedImage {
+    int width;
+    int height;
+    int channels;
+    std::vector<Real> data;
+
+    const Real* pixel(int u, int v) const { return &data[((size_t)v * width + u) * channels]; }
+};
+
+template <typename Real>
+static PaddedImage<Real> padImage(ThreadPool& pool, const tga::TGAImage& image, const Kernel2D& kernel) {
+    PaddedImage<Real> padded;
+    padded.width = (int)image.width + kernel.width - 1;
+    padded.height = (int)image.height + kernel.height - 1;
+    padded.channels = image.bpp / 8;
+    padded.data.resize((size_t)padded.width * padded.height * padded.channels);
+
+    int left = kernel.width - 1 - kernel.width / 2;
+    int top = kernel.height - 1 - kernel.height / 2;
+    int channels = padded.channels;
+    pool.parallelFor(padded.height, [&](int v) {
+        int y = std::min(std::max(v - top, 0), (int)image.height - 1);
+        const unsigned char* row = image.data() + (size_t)y * image.width * channels;
+        Real* target = &padded.data[(size_t)v * padded.width * channels];
+        for (int u = 0; u < padded.width; u++, target += channels) {
+            const unsigned char* source = row + (size_t)std::min(std::max(u - left, 0), (int)image.width - 1) * channels;
+            for (int c = 0; c < channels; c++)
+                target[c] = source[c];
+            if (channels == 4) {
+                for (int c = 0; c < 3; c++)
+                    target[c] = premultiply(source[c], source[3]);
+            }
+        }
+    });
+
+    return padded;
+}
+
+// writes the rows of the convolved image, unpremultiplying RGBA
+template <typename Real>
+static void storeRows(ThreadPool& pool, tga::TGAImage& image, const std::vector<Real>& result) {
+    int channels = image.bpp / 8;
+    size_t rowSize = (size_t)image.width * channels;
+
+    pool.parallelFor((int)image.height, [&](int y) {
+        const Real* source = &result[y * rowSize];
+        unsigned char* target = image.data() + y * rowSize;
+        for (size_t k = 0; k < rowSize; k += channels) {
+            Real pixel[4];
+            for (int c = 0; c < channels; c++)
+                pixel[c] = source[k + c];
+            if (channels == 4)
+                unpremultiplyPixel(pixel);
+            for (int c = 0; c < channels; c++)
+                target[k + c] = roundSaturate(pixel[c]);
+        }
+    });
+}
+
+template <typename Real>
+static void convolveDirectImage(ThreadPool& pool, tga::TGAImage& image, const Kernel2D& kernel) {
+    PaddedImage<Real> padded = padImage<Real>(pool, image, kernel);
+    int width = (int)image.width;
+    int height = (int)image.height;
+    int channels = padded.channels;
+    size_t rowSize = (size_t)width * channels;
+
+    std::vector<Real> weights(kernel.weights.begin(), kernel.weights.end());
+    std::vector<Real> result(rowSize * height);
+
+    pool.parallelFor((height + directRowBlockHeight - 1) / directRowBlockHeight, [&](int block) {
+        int firstRow = block * directRowBlockHeight;
+        int lastRow = std::min(firstRow + directRowBlockHeight, height);
+        for (int y = firstRow; y < lastRow; y++) {
+            Real* sum = &result[y * rowSize];
+            for (int j = 0; j < kernel.height; j++) {
+                for (int i = 0; i < kernel.width; i++) {
+                    Real weight = weights[(size_t)j * kernel.width + i];
+                    if (weight == 0)
+                        continue;
+                    const Real* source = padded.pixel(kernel.width - 1 - i, y + kernel.height - 1 - j);
+                    for (size_t k = 0; k < rowSize; k++)
+                        sum[k] += weight * source[k];
+                }
+            }
+        }
+    });
+
+    storeRows<Real>(pool, image, result);
+}
+
+template <typename Real>
+static void convolveFftImage(ThreadPool& pool, tga::TGAImage& image, const Kernel2D& kernel, const ConvolutionPlan& plan) {
+    PaddedImage<Real> padded = padImage<Real>(pool, image, kernel);
+    int width = (int)image.width;
+    int height = (int)image.height;
+    int channels = padded.channels;
+    int fftSize = plan.fftSize;
+    int tileSize = plan.tileSize;
+    int tilesX = (padded.width + tileSize - 1) / tileSize;
+    int tilesY = (padded.height + tileSize - 1) / tileSize;
+
+    FftPlan<Real> fft(fftSize);
+    std::vector<std::complex<Real>> spectrum = kernelSpectrum<Real>(kernel, fftSize);
+    std::vector<Real> result((size_t)width * height * channels);
+
+    // the tile at (tx, ty) adds to the result pixels tileSize * (tx, ty) - kernel size + 1 and
+    // the fftSize - 1 after them, so tiles two apart are far enough apart to run at the same time
+    for (int round = 0; round < 4; round++) {
+        int firstX = round & 1;
+        int firstY = round >> 1;
+        int roundTilesX = (tilesX - firstX + 1) / 2;
+        int roundTilesY = (tilesY - firstY + 1) / 2;
+
+        pool.parallelFor(roundTilesX * roundTilesY, [&](int index) {
+            int tx = firstX + 2 * (index % roundTilesX);
+            int ty = firstY + 2 * (index / roundTilesX);
+            std::vector<std::complex<Real>> tile((size_t)fftSize * fftSize), scratch;
+
+            // two channels go through one complex transform, the kernel is real so they do not mix
+            for (int first = 0; first < channels; first += 2) {
+                int second = first + 1 < channels ? first + 1 : -1;
+
+                std::fill(tile.begin(), tile.end(), std::complex<Real>());
+                for (int j = 0; j < tileSize && ty * tileSize + j < padded.height; j++) {
+                    for (int i = 0; i < tileSize && tx * tileSize + i < padded.width; i++) {
+                        const Real* pixel = padded.pixel(tx * tileSize + i, ty * tileSize + j);
+                        tile[(size_t)j * fftSize + i] = std::complex<Real>(pixel[first], second >= 0 ? pixel[second] : 0);
+                    }
+                }
+
+                fft.transform2d(tile.data(), scratch, false);
+                for (size_t k = 0; k < tile.size(); k++)
+                    tile[k] = complexMultiply(tile[k], spectrum[k]);
+                fft.transform2d(tile.data(), scratch, true);
+
+                for (int j = 0; j < fftSize; j++) {
+                    int y = ty * tileSize + j - (kernel.height - 1);
+                    if (y < 0 || y >= height)
+                        continue;
+                    for (int i = 0; i < fftSize; i++) {
+                        int x = tx * tileSize + i - (kernel.width - 1);
+                        if (x < 0 || x >= width)
+                            continue;
+                        Real* target = &result[((size_t)y * width + x) * channels];
+                        const std::complex<Real>& value = tile[(size_t)j * fftSize + i];
+                        target[first] += value.real();
+                        if (second >= 0)
+                            target[second] += value.imag();
+                    }
+                }
+            }
+        });
+    }
+
+    storeRows<Real>(pool, image, result);
+}
+
+void convolveDirect(ThreadPool& pool, tga::TGAImage& image, const Kernel2D& kernel, Precision precision) {
+    if (precision == Precision::Double)
+        convolveDirectImage<double>(pool, image, kernel);
+    else
+        convolveDirectImage<float>(pool, image, kernel);
+}
+
+void convolveFft(ThreadPool& pool, tga::TGAImage& image, const Kernel2D& kernel, const ConvolutionPlan& plan, Precision precision) {
+    if (precision == Precision::Double)
+        convolveFftImage<double>(pool, image, kernel, plan);
+    else
+        convolveFftImage<float>(pool, image, kernel, plan);
+}
@@ -0,0 +1,22 @@
+#ifndef GAUSSIAN_BLUR_CPU_CONVOLUTION_H
+#define GAUSSIAN_BLUR_CPU_CONVOLUTION_H
+
+#include "blur_backend.h"
+#include "convolution.h"
+#include "thread_pool.h"
+#include "tga.h"
+
+// The 2D convolutions of the cpu engine. Edges are clamped and RGBA is convolved with
+// premultiplied alpha like the blur. Both work on a copy of the image that is padded by the
+// kernel on every side, so the inner loops need no clamping.
+
+// every output row multiplies the padded rows under the kernel with its weights, the rows are spread over the threads
+void convolveDirect(ThreadPool& pool, tga::TGAImage& image, const Kernel2D& kernel, Precision precision);
+
+// Overlap-add: the padded image is cut into tileSize tiles, every tile is convolved through
+// its spectrum on an fftSize tile and added into the result together with the part that
+// spills over into its neighbours. The tiles are spread over the threads in four rounds, in
+// each round only every other tile in both directions runs, and those never overlap.
+void convolveFft(ThreadPool& pool, tga::TGAImage& image, const Kernel2D& kernel, const ConvolutionPlan& plan, Precision precision);
+
+#endif //GAUSSIAN_BLUR_CPU_CONVOLUTION_H
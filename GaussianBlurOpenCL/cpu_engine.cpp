@@ -0,0 +1,390 @@
+#include "cpu_engine.h"
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include "cpu_convolution.h"
+#include "gaussian_blur.h"
+
+// rows per horizontal task and pixels per vertical column strip. The 2 * radius + 1 rows of a
+// strip the vertical taps read are only a few KiB, so they stay in the cache between output rows.
+static const int rowBlockHeight = 16;
+static const int columnStripWidth = 64;
+
+// pixels per side of the blocks of the transposed vertical pass, a source and a target block of
+// RGBA pixels take 8 KiB together and fit into the L1 cache
+static const int transposeBlockSize = 32;
+
+// pixels per column strip of the box and iir methods, a whole column of the strip is kept in two buffers
+static const int lineStripWidth = 16;
+
+static void blurRowDouble(const unsigned char* center, unsigned char* out, size_t count, int stride, const double* weights, int radius, bool unpremultiply) {
+    blurRowReference<double>(center, out, count, stride, weights, radius, unpremultiply);
+}
+
+static void blurColumnDouble(const unsigned char* const* rows, unsigned char* out, size_t count, const double* weights, int radius, bool unpremultiply) {
+    blurColumnReference<double>(rows, out, count, weights, radius, unpremultiply);
+}
+
+// The source pass premultiplies RGBA while loading, the row pass over the transposed image
+// unpremultiplies it in the end instead.
+template <typename Real>
+static void blurRows(RowKernel<Real> blurRow, const unsigned char* image, unsigned char* out, int width, int channels, int firstRow, int lastRow, const Real* weights, int radius, bool sourcePass) {
+    std::vector<unsigned char> row((size_t)(width + 2 * radius) * channels);
+
+    for (int y = firstRow; y < lastRow; y++) {
+        const unsigned char* source = image + (size_t)y * width * channels;
+
+        // the row with radius clamped pixels on each side
+        for (int i = 0; i < width + 2 * radius; i++) {
+            int x = std::min(std::max(i - radius, 0), width - 1);
+            const unsigned char* pixel = source + (size_t)x * channels;
+            unsigned char* padded = &row[(size_t)i * channels];
+            for (int c = 0; c < channels; c++)
+                padded[c] = pixel[c];
+            if (channels == 4 && sourcePass) {
+                for (int c = 0; c < 3; c++)
+                    padded[c] = premultiply(pixel[c], pixel[3]);
+            }
+        }
+
+        blurRow(&row[(size_t)radius * channels], out + (size_t)y * width * channels, (size_t)width * channels, channels, weights, radius, channels == 4 && !sourcePass);
+    }
+}
+
+template <typename Real>
+static void blurColumns(ColumnKernel<Real> blurColumn, const unsigned char* temp, unsigned char* image, int width, int height, int channels, int firstColumn, int lastColumn, const Real* weights, int radius) {
+    size_t stride = (size_t)width * channels;
+    size_t offset = (size_t)firstColumn * channels;
+    size_t stripSize = (size_t)(lastColumn - firstColumn) * channels;
+    std::vector<const unsigned char*> rows(2 * radius + 1);
+
+    for (int y = 0; y < height; y++) {
+        // the strip segments of the rows the taps read, clamped to the edge
+        for (int i = -radius; i <= radius; i++)
+            rows[radius + i] = temp + (size_t)std::min(std::max(y + i, 0), height - 1) * stride + offset;
+
+        blurColumn(rows.data(), image + (size_t)y * stride + offset, stripSize, weights, radius, channels == 4);
+    }
+}
+
+// the values a line filter runs along at the same time, a block of rows or a column strip of RGBA pixels
+static const int maxLineLanes = std::max(rowBlockHeight, lineStripWidth) * 4;
+
+// One box blur along lines of length elements with lanes interleaved values each, a block of
+// rows has the channels of all its rows as lanes and a column strip its row segment. The running sum adds
+// the element entering the window and drops the one leaving it, edges are clamped. The sums
+// live on the stack, so the compiler knows the stores to out do not change them.
+template <typename Real>
+static void boxPass(const Real* in, Real* out, int length, size_t lanes, int radius) {
+    Real scale = (Real)1 / (Real)(2 * radius + 1);
+
+    Real sums[maxLineLanes] = {};
+    for (int i = -radius; i <= radius; i++) {
+        const Real* line = in + (size_t)std::min(std::max(i, 0), length - 1) * lanes;
+        for (size_t lane = 0; lane < lanes; lane++)
+            sums[lane] += line[lane];
+    }
+
+    for (int i = 0; i < length; i++) {
+        Real* target = out + (size_t)i * lanes;
+        const Real* leaving = in + (size_t)std::max(i - radius, 0) * lanes;
+        const Real* entering = in + (size_t)std::min(i + radius + 1, length - 1) * lanes;
+        for (size_t lane = 0; lane < lanes; lane++) {
+            target[lane] = sums[lane] * scale;
+            sums[lane] += entering[lane] - leaving[lane];
+        }
+    }
+}
+
+// the three boxes in a and b, the result ends up in b
+template <typename Real>
+struct BoxFilter {
+    int radii[3];
+
+    void operator()(std::vector<Real>& a, std::vector<Real>& b, int length, size_t lanes) const {
+        boxPass<Real>(a.data(), b.data(), length, lanes, radii[0]);
+        boxPass<Real>(b.data(), a.data(), length, lanes, radii[1]);
+        boxPass<Real>(a.data(), b.data(), length, lanes, radii[2]);
+    }
+};
+
+// The recursive gaussian along lines like boxPass, a causal pass from a to b followed by an
+// anticausal pass in place. The image continues with its first pixel before the line, which is
+// the steady state of the causal pass, and with its last one after it, where the boundary
+// matrix gives the anticausal pass its start.
+template <typename Real>
+struct IirFilter {
+    double coefficients[4];
+    double boundary[9];
+
+    void operator()(std::vector<Real>& a, std::vector<Real>& b, int length, size_t lanes) const {
+        Real scale = (Real)coefficients[0];
+        Real a1 = (Real)coefficients[1];
+        Real a2 = (Real)coefficients[2];
+        Real a3 = (Real)coefficients[3];
+        const Real* in = a.data();
+        Real* out = b.data();
+
+        for (int i = 0; i < length; i++) {
+            const Real* x = in + (size_t)i * lanes;
+            const Real* w1 = i >= 1 ? out + (size_t)(i - 1) * lanes : in;
+            const Real* w2 = i >= 2 ? out + (size_t)(i - 2) * lanes : in;
+            const Real* w3 = i >= 3 ? out + (size_t)(i - 3) * lanes : in;
+            Real* w = out + (size_t)i * lanes;
+            for (size_t lane = 0; lane < lanes; lane++)
+                w[lane] = scale * x[lane] + a1 * w1[lane] + a2 * w2[lane] + a3 * w3[lane];
+        }
+
+        // the anticausal outputs of the three pixels past the end
+        Real tail[3][maxLineLanes];
+        const Real* last = in + (size_t)(length - 1) * lanes;
+        for (int k = 0; k < 3; k++) {
+            for (size_t lane = 0; lane < lanes; lane++) {
+                Real edge = last[lane];
+                Real y = edge;
+                for (int j = 0; j < 3; j++) {
+                    Real w = length - 1 - j >= 0 ? out[(size_t)(length - 1 - j) * lanes + lane] : in[lane];
+                    y += (Real)boundary[k * 3 + j] * (w - edge);
+                }
+                tail[k][lane] = y;
+            }
+        }
+
+        const Real* next[3] = { tail[0], tail[1], tail[2] };
+        for (int i = length - 1; i >= 0; i--) {
+            Real* y = out + (size_t)i * lanes;
+            for (size_t lane = 0; lane < lanes; lane++)
+                y[lane] = scale * y[lane] + a1 * next[0][lane] + a2 * next[1][lane] + a3 * next[2][lane];
+            next[2] = next[1];
+            next[1] = next[0];
+            next[0] = y;
+        }
+    }
+};
+
+// The rows of the block are interleaved pixel by pixel, so the filter advances along all of
+// them at once like along the columns of a strip. The filter leaves its result in b.
+template <typename Real, typename Filter>
+static void filterRows(const Filter& filter, const unsigned char* image, unsigned char* out, int width, int channels, int firstRow, int lastRow) {
+    size_t rowSize = (size_t)width * channels;
+    size_t lanes = (size_t)(lastRow - firstRow) * channels;
+    std::vector<Real> a(lanes * width), b(lanes * width);
+
+    for (int y = firstRow; y < lastRow; y++) {
+        const unsigned char* source = image + y * rowSize;
+        Real* line = &a[(y - firstRow) * channels];
+        for (int x = 0; x < width; x++, source += channels, line += lanes) {
+            for (int c = 0; c < channels; c++)
+                line[c] = (Real)source[c];
+            if (channels == 4) {
+                for (int c = 0; c < 3; c++)
+                    line[c] = (Real)premultiply(source[c], source[3]);
+            }
+        }
+    }
+
+    filter(a, b, width, lanes);
+
+    for (int y = firstRow; y < lastRow; y++) {
+        unsigned char* target = out + y * rowSize;
+        const Real* line = &b[(y - firstRow) * channels];
+        for (int x = 0; x < width; x++, target += channels, line += lanes) {
+            for (int c = 0; c < channels; c++)
+                target[c] = roundSaturate(line[c]);
+        }
+    }
+}
+
+template <typename Real, typename Filter>
+static void filterColumns(const Filter& filter, const unsigned char* temp, unsigned char* image, int width, int height, int channels, int firstColumn, int lastColumn) {
+    size_t stride = (size_t)width * channels;
+    size_t offset = (size_t)firstColumn * channels;
+    size_t lanes = (size_t)(lastColumn - firstColumn) * channels;
+    std::vector<Real> a(lanes * height), b(lanes * height);
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char* source = temp + y * stride + offset;
+        for (size_t k = 0; k < lanes; k++)
+            a[y * lanes + k] = (Real)source[k];
+    }
+
+    filter(a, b, height, lanes);
+
+    for (int y = 0; y < height; y++) {
+        Real* blur = &b[y * lanes];
+        unsigned char* target = image + y * stride + offset;
+        if (channels == 4) {
+            for (size_t k = 0; k < lanes; k += 4)
+                unpremultiplyPixel(blur + k);
+        }
+        for (size_t k = 0; k < lanes; k++)
+            target[k] = roundSaturate(blur[k]);
+    }
+}
+
+CpuBlurEngine::CpuBlurEngine(const CpuEngineOptions& options) : pool(options.threads), verticalPass(options.verticalPass) {
+    kernels = cpuKernels(options.isa);
+    if (!kernels) {
+        printf("Error: The cpu does not support %s!\n", cpuIsaName(options.isa));
+        exit(EXIT_FAILURE);
+    }
+    name = std::string("cpu ") + cpuIsaName(kernels->isa) + ", " + std::to_string(pool.threadCount()) + " threads";
+}
+
+// copies the rows of the block starting at firstRow into the columns of the height pixels wide target
+static void transposeRows(const unsigned char* image, unsigned char* out, int width, int height, int channels, int firstRow) {
+    int lastRow = std::min(firstRow + transposeBlockSize, height);
+
+    for (int firstColumn = 0; firstColumn < width; firstColumn += transposeBlockSize) {
+        int lastColumn = std::min(firstColumn + transposeBlockSize, width);
+        for (int y = firstRow; y < lastRow; y++) {
+            const unsigned char* source = image + ((size_t)y * width + firstColumn) * channels;
+            for (int x = firstColumn; x < lastColumn; x++, source += channels) {
+                unsigned char* target = out + ((size_t)x * height + y) * channels;
+                for (int c = 0; c < channels; c++)
+                    target[c] = source[c];
+            }
+        }
+    }
+}
+
+// the center weight and the weights of increasing distance in the compute type, like BLUR_WEIGHTS
+template <typename Real>
+static std::vector<Real> passWeights(int kernelSize, double sigma) {
+    int radius = kernelSize / 2;
+    double* blurKernel = _1d_blur_kernel(kernelSize, sigma);
+    std::vector<Real> weights(blurKernel + radius, blurKernel + kernelSize);
+    delete[] blurKernel;
+    return weights;
+}
+
+// fixed point weights are quantized from the double kernel as a whole so that they keep summing up to one
+template <>
+std::vector<short> passWeights<short>(int kernelSize, double sigma) {
+    int radius = kernelSize / 2;
+    short* blurKernel = _1d_blur_kernel_fixed(kernelSize, sigma, fixedPointBits);
+    std::vector<short> weights(blurKernel + radius, blurKernel + kernelSize);
+    delete[] blurKernel;
+    return weights;
+}
+
+template <typename Real>
+void CpuBlurEngine::blurImage(tga::TGAImage& image, int kernelSize, double sigma, RowKernel<Real> blurRow, ColumnKernel<Real> blurColumn) {
+    int width = (int)image.width;
+    int height = (int)image.height;
+    int channels = image.bpp / 8;
+    int radius = kernelSize / 2;
+
+    std::vector<Real> weights = passWeights<Real>(kernelSize, sigma);
+
+    temp.resize((size_t)width * height * channels);
+    unsigned char* data = image.data();
+    unsigned char* tempData = temp.data();
+
+    pool.parallelFor((height + rowBlockHeight - 1) / rowBlockHeight, [&](int block) {
+        int firstRow = block * rowBlockHeight;
+        blurRows<Real>(blurRow, data, tempData, width, channels, firstRow, std::min(firstRow + rowBlockHeight, height), weights.data(), radius, true);
+    });
+
+    if (verticalPass == VerticalPass::Transposed) {
+        // the columns become contiguous rows of a height x width image, blurred by the row kernel
+        transposed.resize(temp.size());
+        unsigned char* transposedData = transposed.data();
+
+        pool.parallelFor((height + transposeBlockSize - 1) / transposeBlockSize, [&](int block) {
+            transposeRows(tempData, transposedData, width, height, channels, block * transposeBlockSize);
+        });
+        pool.parallelFor((width + rowBlockHeight - 1) / rowBlockHeight, [&](int block) {
+            int firstRow = block * rowBlockHeight;
+            blurRows<Real>(blurRow, transposedData, tempData, height, channels, firstRow, std::min(firstRow + rowBlockHeight, width), weights.data(), radius, false);
+        });
+        pool.parallelFor((width + transposeBlockSize - 1) / transposeBlockSize, [&](int block) {
+            transposeRows(tempData, data, height, width, channels, block * transposeBlockSize);
+        });
+        return;
+    }
+
+    pool.parallelFor((width + columnStripWidth - 1) / columnStripWidth, [&](int strip) {
+        int firstColumn = strip * columnStripWidth;
+        blurColumns<Real>(blurColumn, tempData, data, width, height, channels, firstColumn, std::min(firstColumn + columnStripWidth, width), weights.data(), radius);
+    });
+}
+
+template <typename Real, typename Filter>
+void CpuBlurEngine::filterImage(tga::TGAImage& image, const Filter& filter) {
+    int width = (int)image.width;
+    int height = (int)image.height;
+    int channels = image.bpp / 8;
+
+    // the line filters touch every pixel a constant number of times, the columns are read
+    // in narrow strips whatever vertical pass is selected
+    temp.resize((size_t)width * height * channels);
+    unsigned char* data = image.data();
+    unsigned char* tempData = temp.data();
+
+    pool.parallelFor((height + rowBlockHeight - 1) / rowBlockHeight, [&](int block) {
+        int firstRow = block * rowBlockHeight;
+        filterRows<Real>(filter, data, tempData, width, channels, firstRow, std::min(firstRow + rowBlockHeight, height));
+    });
+
+    pool.parallelFor((width + lineStripWidth - 1) / lineStripWidth, [&](int strip) {
+        int firstColumn = strip * lineStripWidth;
+        filterColumns<Real>(filter, tempData, data, width, height, channels, firstColumn, std::min(firstColumn + lineStripWidth, width));
+    });
+}
+
+void CpuBlurEngine::blurAsync(int, tga::TGAImage& image, int kernelSize, double sigma, Precision precision, BlurMethod method) {
+    if (!supportsPrecision(precision)) {
+        printf("Error: The cpu engine does not support the requested precision!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (image.dataSize() == 0)
+        return;
+
+    if (method == BlurMethod::Box3) {
+        if (precision == Precision::Double) {
+            BoxFilter<double> filter;
+            _box_blur_radii(sigma, 3, filter.radii);
+            filterImage<double>(image, filter);
+        } else {
+            BoxFilter<float> filter;
+            _box_blur_radii(sigma, 3, filter.radii);
+            filterImage<float>(image, filter);
+        }
+        return;
+    }
+
+    // the poles of the recursion approach one as sigma grows and float loses the small
+    // differences it feeds back, above sigma 20 visibly. The recursion always runs in double
+    if (method == BlurMethod::Iir) {
+        IirFilter<double> filter;
+        _iir_blur_coefficients(sigma, filter.coefficients, filter.boundary);
+        filterImage<double>(image, filter);
+        return;
+    }
+
+    // the SIMD kernels compute in float and fixed point, double always runs on the scalar reference
+    if (precision == Precision::Fixed)
+        blurImage<short>(image, kernelSize, sigma, kernels->blurRowFixed, kernels->blurColumnFixed);
+    else if (precision == Precision::Double)
+        blurImage<double>(image, kernelSize, sigma, blurRowDouble, blurColumnDouble);
+    else
+        blurImage<float>(image, kernelSize, sigma, kernels->blurRow, kernels->blurColumn);
+}
+
+void CpuBlurEngine::convolve(tga::TGAImage& image, const Kernel2D& kernel, const ConvolutionPlan& plan, Precision precision) {
+    if (!supportsPrecision(precision)) {
+        printf("Error: The cpu engine does not support the requested precision!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (image.dataSize() == 0)
+        return;
+
+    if (plan.algorithm == ConvolutionAlgorithm::Fft)
+        convolveFft(pool, image, kernel, plan, precision);
+    else
+        convolveDirect(pool, image, kernel, precision);
+}
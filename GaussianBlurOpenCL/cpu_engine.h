@@ -0,0 +1,58 @@
+#ifndef GAUSSIAN_BLUR_CPU_ENGINE_H
+#define GAUSSIAN_BLUR_CPU_ENGINE_H
+
+#include <string>
+#include <vector>
+#include "blur_backend.h"
+#include "thread_pool.h"
+#include "cpu_kernels.h"
+
+struct CpuEngineOptions {
+    // zero uses every hardware thread
+    int threads = 0;
+    // the instruction set of the float kernels, scalar is the reference the SIMD kernels are verified against
+    CpuIsa isa = CpuIsa::Auto;
+    VerticalPass verticalPass = VerticalPass::Direct;
+};
+
+// The same separable blur as gauss.cl on the cpu, for hosts without an OpenCL driver.
+// The horizontal pass hands out blocks of rows to the thread pool, the vertical pass
+// narrow column strips, so the rows the vertical taps read stay in the cache.
+// Edges are clamped and RGBA is blurred with premultiplied alpha like on the device.
+// The float and fixed point kernels of the exact method use the widest SIMD instruction set the cpu supports,
+// the running sums of the box method and the recursions of the iir method are left to the compiler.
+class CpuBlurEngine : public BlurBackend {
+public:
+    explicit CpuBlurEngine(const CpuEngineOptions& options = CpuEngineOptions());
+
+    // the cpu blurs synchronously, so blurAsync already returns with the finished image
+    void blurAsync(int slot, tga::TGAImage& image, int kernelSize, double sigma, Precision precision = Precision::Float, BlurMethod method = BlurMethod::Exact) override;
+    void finish(int) override {}
+
+    void convolve(tga::TGAImage& image, const Kernel2D& kernel, const ConvolutionPlan& plan, Precision precision = Precision::Float) override;
+
+    int slotCount() const override { return 1; }
+
+    // there is no native half arithmetic on the cpu
+    bool supportsPrecision(Precision precision) const override { return precision != Precision::Half; }
+    Precision preferredPrecision() const override { return Precision::Float; }
+
+    const std::string& deviceName() const override { return name; }
+
+private:
+    template <typename Real>
+    void blurImage(tga::TGAImage& image, int kernelSize, double sigma, RowKernel<Real> blurRow, ColumnKernel<Real> blurColumn);
+    // the box and iir methods, the filter runs along interleaved rows and columns of Real values
+    template <typename Real, typename Filter>
+    void filterImage(tga::TGAImage& image, const Filter& filter);
+
+    ThreadPool pool;
+    const CpuKernels* kernels = nullptr;
+    VerticalPass verticalPass;
+    std::string name;
+    // the result of the horizontal pass and its transpose, both only grow
+    std::vector<unsigned char> temp;
+    std::vector<unsigned char> transposed;
+};
+
+#endif //GAUSSIAN_BLUR_CPU_ENGINE_H
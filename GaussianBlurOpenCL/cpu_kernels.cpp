@@ -0,0 +1,122 @@
+#include "cpu_kernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+const char* cpuIsaName(CpuIsa isa) {
+    switch (isa) {
+    case CpuIsa::Scalar: return "scalar";
+    case CpuIsa::Sse41:  return "sse4.1";
+    case CpuIsa::Avx2:   return "avx2";
+    case CpuIsa::Avx512: return "avx512";
+    default:             return "auto";
+    }
+}
+
+static void blurRowScalar(const unsigned char* center, unsigned char* out, size_t count, int stride, const float* weights, int radius, bool unpremultiply) {
+    blurRowReference<float>(center, out, count, stride, weights, radius, unpremultiply);
+}
+
+static void blurColumnScalar(const unsigned char* const* rows, unsigned char* out, size_t count, const float* weights, int radius, bool unpremultiply) {
+    blurColumnReference<float>(rows, out, count, weights, radius, unpremultiply);
+}
+
+static void blurRowFixedScalar(const unsigned char* center, unsigned char* out, size_t count, int stride, const short* weights, int radius, bool unpremultiply) {
+    blurRowFixedReference(center, out, count, stride, weights, radius, unpremultiply);
+}
+
+static void blurColumnFixedScalar(const unsigned char* const* rows, unsigned char* out, size_t count, const short* weights, int radius, bool unpremultiply) {
+    blurColumnFixedReference(rows, out, count, weights, radius, unpremultiply);
+}
+
+static void swapRedBlueScalar(const unsigned char* source, unsigned char* target, size_t pixels, int bytesPerPixel) {
+    swapRedBlueReference(source, target, pixels, bytesPerPixel);
+}
+
+static const CpuKernels scalarKernels = { CpuIsa::Scalar, blurRowScalar, blurColumnScalar, blurRowFixedScalar, blurColumnFixedScalar, swapRedBlueScalar };
+
+#ifdef CPU_X86
+static void cpuid(int leaf, int subleaf, unsigned int registers[4]) {
+#if defined(_MSC_VER)
+    int values[4];
+    __cpuidex(values, leaf, subleaf);
+    for (int i = 0; i < 4; i++)
+        registers[i] = (unsigned int)values[i];
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// the register state the operating system saves on a context switch
+static unsigned long long xgetbv() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+struct CpuFeatures {
+    bool sse41 = false;
+    bool avx2 = false;
+    bool avx512 = false;
+};
+
+static CpuFeatures detectCpuFeatures() {
+    CpuFeatures features;
+    unsigned int registers[4];
+
+    cpuid(0, 0, registers);
+    unsigned int maxLeaf = registers[0];
+
+    cpuid(1, 0, registers);
+    features.sse41 = (registers[2] & (1u << 19)) != 0;
+    bool fma = (registers[2] & (1u << 12)) != 0;
+    bool osxsave = (registers[2] & (1u << 27)) != 0;
+    bool avx = (registers[2] & (1u << 28)) != 0;
+    if (!osxsave || !avx || maxLeaf < 7)
+        return features;
+
+    // the instructions are only usable if the operating system saves the ymm and zmm registers
+    unsigned long long xcr0 = xgetbv();
+    bool ymmState = (xcr0 & 0x6) == 0x6;
+    bool zmmState = (xcr0 & 0xe6) == 0xe6;
+
+    cpuid(7, 0, registers);
+    features.avx2 = ymmState && fma && (registers[1] & (1u << 5)) != 0;
+    features.avx512 = zmmState && (registers[1] & (1u << 16)) != 0;
+    return features;
+}
+#endif
+
+const CpuKernels* cpuKernels(CpuIsa isa) {
+#ifdef CPU_X86
+    static const CpuFeatures features = detectCpuFeatures();
+
+    switch (isa) {
+    case CpuIsa::Scalar: return &scalarKernels;
+    case CpuIsa::Sse41:  return features.sse41 ? sse41Kernels() : NULL;
+    case CpuIsa::Avx2:   return features.avx2 ? avx2Kernels() : NULL;
+    case CpuIsa::Avx512: return features.avx512 ? avx512Kernels() : NULL;
+    default:
+        break;
+    }
+
+    // the widest instruction set that the cpu and the build support
+    const CpuKernels* kernels = NULL;
+    if (!kernels && features.avx512) kernels = avx512Kernels();
+    if (!kernels && features.avx2) kernels = avx2Kernels();
+    if (!kernels && features.sse41) kernels = sse41Kernels();
+    return kernels ? kernels : &scalarKernels;
+#else
+    return isa == CpuIsa::Scalar || isa == CpuIsa::Auto ? &scalarKernels : NULL;
+#endif
+}
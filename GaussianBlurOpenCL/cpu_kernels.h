@@ -0,0 +1,207 @@
+#ifndef GAUSSIAN_BLUR_CPU_KERNELS_H
+#define GAUSSIAN_BLUR_CPU_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include "blur_backend.h"
+
+// instruction sets the cpu engine has kernels for, auto picks the best one the cpu supports
+enum class CpuIsa {
+    Auto,
+    Scalar,
+    Sse41,
+    Avx2,
+    Avx512
+};
+
+const char* cpuIsaName(CpuIsa isa);
+
+// out[k] = blur of center[k] with the taps center[k -+ i * stride], center has radius pixels of padding.
+// The row pass over the transposed image unpremultiplies RGBA afterwards like the column pass.
+template <typename Real>
+using RowKernel = void (*)(const unsigned char* center, unsigned char* out, size_t count, int stride, const Real* weights, int radius, bool unpremultiply);
+
+// out[k] = blur of rows[radius][k] with the taps rows[radius -+ i][k], RGBA is unpremultiplied afterwards
+template <typename Real>
+using ColumnKernel = void (*)(const unsigned char* const* rows, unsigned char* out, size_t count, const Real* weights, int radius, bool unpremultiply);
+
+// target = source with the first and third byte of every pixel swapped, tga stores BGR(A) and
+// the images are RGB(A). source and target may be the same
+using SwapKernel = void (*)(const unsigned char* source, unsigned char* target, size_t pixels, int bytesPerPixel);
+
+// The inner loops of the cpu engine for one instruction set. Both work on the interleaved 8 bit
+// data as a flat array, the taps of a pixel channel are stride bytes apart in a row and one row
+// apart in a column. weights[i] is the weight of the two taps at distance i, which are summed as
+// integers before the multiplication like in gauss.cl.
+// The fixed point kernels take the 16 bit weights of _1d_blur_kernel_fixed and add up in 32 bit integers.
+struct CpuKernels {
+    CpuIsa isa;
+    RowKernel<float> blurRow;
+    ColumnKernel<float> blurColumn;
+    RowKernel<short> blurRowFixed;
+    ColumnKernel<short> blurColumnFixed;
+    SwapKernel swapRedBlue;
+};
+
+// the kernels for the instruction set, NULL if the cpu or the build does not support it
+const CpuKernels* cpuKernels(CpuIsa isa);
+
+// The SIMD tables, each is NULL when its instruction set is missing. Their functions carry a
+// target attribute, gcc and clang only emit the instructions in functions that ask for them.
+const CpuKernels* sse41Kernels();
+const CpuKernels* avx2Kernels();
+const CpuKernels* avx512Kernels();
+
+// AVX-512 F has no byte shuffle, its table swaps with the one of AVX2
+void swapRedBlueAvx2(const unsigned char* source, unsigned char* target, size_t pixels, int bytesPerPixel);
+
+// exact rounded c * a / 255, the same integer formula as premultiply in gauss.cl
+inline unsigned char premultiply(unsigned char color, unsigned char alpha) {
+    unsigned int product = (unsigned int)color * alpha + 128;
+    return (unsigned char)((product + (product >> 8)) >> 8);
+}
+
+// rounds half away from zero like round() in gauss.cl and saturates like convert_uchar_sat, the
+// SIMD kernels truncate and add one where the fraction is at least .5, the values are never negative
+template <typename Real>
+inline unsigned char roundSaturate(Real value) {
+    value = std::round(value);
+    if (!(value > 0))
+        return 0;
+    if (value > 255)
+        return 255;
+    return (unsigned char)value;
+}
+
+// the SIMD kernels with fused multiply-add round once per tap, their tails have to do the same
+template <bool Fused, typename Real>
+inline Real multiplyAdd(Real a, Real b, Real c) {
+    return Fused ? std::fma(a, b, c) : a * b + c;
+}
+
+// The scalar reference of both kernels. The SSE 4.1 kernels match it exactly, the FMA kernels
+// match the Fused variant exactly, and the two only differ where a sum lies within rounding of .5.
+// divides the alpha back out like unpremultiply in gauss.cl, fully transparent pixels stay black
+template <typename Real>
+inline void unpremultiplyPixel(Real blur[4]) {
+    Real scale = blur[3] >= (Real)0.5 ? (Real)255 / blur[3] : (Real)0;
+    blur[0] *= scale;
+    blur[1] *= scale;
+    blur[2] *= scale;
+}
+
+// The SIMD kernels leave the last elements from first on to the references. Their loops cover
+// whole pixels, so first is at a pixel boundary and the references unpremultiply whole pixels.
+template <typename Real, bool Fused = false>
+void blurRowReference(const unsigned char* center, unsigned char* out, size_t count, int stride, const Real* weights, int radius, bool unpremultiply, size_t first = 0) {
+    size_t channels = unpremultiply ? 4 : 1;
+
+    for (size_t k = first; k < count; k += channels) {
+        Real blur[4];
+        for (size_t c = 0; c < channels; c++) {
+            blur[c] = (Real)center[k + c] * weights[0];
+            for (int i = 1; i <= radius; i++)
+                blur[c] = multiplyAdd<Fused>((Real)(center[k + c - (size_t)i * stride] + center[k + c + (size_t)i * stride]), weights[i], blur[c]);
+        }
+
+        if (unpremultiply)
+            unpremultiplyPixel(blur);
+
+        for (size_t c = 0; c < channels; c++)
+            out[k + c] = roundSaturate(blur[c]);
+    }
+}
+
+template <typename Real, bool Fused = false>
+void blurColumnReference(const unsigned char* const* rows, unsigned char* out, size_t count, const Real* weights, int radius, bool unpremultiply, size_t first = 0) {
+    const unsigned char* const* center = rows + radius;
+    size_t channels = unpremultiply ? 4 : 1;
+
+    for (size_t k = first; k < count; k += channels) {
+        Real blur[4];
+        for (size_t c = 0; c < channels; c++) {
+            blur[c] = (Real)center[0][k + c] * weights[0];
+            for (int i = 1; i <= radius; i++)
+                blur[c] = multiplyAdd<Fused>((Real)(center[-i][k + c] + center[i][k + c]), weights[i], blur[c]);
+        }
+
+        if (unpremultiply)
+            unpremultiplyPixel(blur);
+
+        for (size_t c = 0; c < channels; c++)
+            out[k + c] = roundSaturate(blur[c]);
+    }
+}
+
+// rounds a fixed point sum half up like round_pass in gauss.cl, the sums are never negative
+inline unsigned char roundFixed(int sum) {
+    int value = (sum + (1 << (fixedPointBits - 1))) >> fixedPointBits;
+    return (unsigned char)(value > 255 ? 255 : value);
+}
+
+// the integer unpremultiply of finish_pass in gauss.cl, color * 255 / alpha rounded half up.
+// Below half an alpha level the color turns black, which also covers a zero alpha. The SIMD
+// kernels divide in double: the dividends stay below 2^31 and the divisors below 2^24, so the
+// quotient never rounds up to the next integer and truncating it gives the exact integer quotient
+inline void finishFixedPixel(const int blur[4], unsigned char* out) {
+    unsigned int alpha = (unsigned int)blur[3];
+    for (int c = 0; c < 3; c++) {
+        unsigned int color = alpha >= (1u << (fixedPointBits - 1)) ? ((unsigned int)blur[c] * 510u + alpha) / (2u * alpha) : 0u;
+        out[c] = (unsigned char)(color > 255u ? 255u : color);
+    }
+    out[3] = roundFixed(blur[3]);
+}
+
+// The fixed point references, the integer sums make every instruction set compute the same bits.
+// Like the float references they take over from first on, which is at a pixel boundary.
+inline void blurRowFixedReference(const unsigned char* center, unsigned char* out, size_t count, int stride, const short* weights, int radius, bool unpremultiply, size_t first = 0) {
+    size_t channels = unpremultiply ? 4 : 1;
+
+    for (size_t k = first; k < count; k += channels) {
+        int blur[4];
+        for (size_t c = 0; c < channels; c++) {
+            blur[c] = center[k + c] * weights[0];
+            for (int i = 1; i <= radius; i++)
+                blur[c] += (center[k + c - (size_t)i * stride] + center[k + c + (size_t)i * stride]) * weights[i];
+        }
+
+        if (unpremultiply)
+            finishFixedPixel(blur, out + k);
+        else
+            out[k] = roundFixed(blur[0]);
+    }
+}
+
+inline void blurColumnFixedReference(const unsigned char* const* rows, unsigned char* out, size_t count, const short* weights, int radius, bool unpremultiply, size_t first = 0) {
+    const unsigned char* const* center = rows + radius;
+    size_t channels = unpremultiply ? 4 : 1;
+
+    for (size_t k = first; k < count; k += channels) {
+        int blur[4];
+        for (size_t c = 0; c < channels; c++) {
+            blur[c] = center[0][k + c] * weights[0];
+            for (int i = 1; i <= radius; i++)
+                blur[c] += (center[-i][k + c] + center[i][k + c]) * weights[i];
+        }
+
+        if (unpremultiply)
+            finishFixedPixel(blur, out + k);
+        else
+            out[k] = roundFixed(blur[0]);
+    }
+}
+
+// every byte is read before the pixel is written, so the swap works in place
+inline void swapRedBlueReference(const unsigned char* source, unsigned char* target, size_t pixels, int bytesPerPixel, size_t first = 0) {
+    for (size_t k = first * bytesPerPixel; k < pixels * bytesPerPixel; k += bytesPerPixel) {
+        unsigned char blue = source[k];
+        unsigned char red = source[k + 2];
+        target[k] = red;
+        target[k + 1] = source[k + 1];
+        target[k + 2] = blue;
+        if (bytesPerPixel == 4)
+            target[k + 3] = source[k + 3];
+    }
+}
+
+#endif //GAUSSIAN_BLUR_CPU_KERNELS_H
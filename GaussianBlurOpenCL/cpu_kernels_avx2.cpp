@@ -0,0 +1,215 @@
+#include "cpu_kernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#else
+#define AVX2_TARGET
+#endif
+
+// independent accumulators per iteration, enough to hide the latency of the fused multiply-adds
+static const int unroll = 4;
+
+AVX2_TARGET static inline __m256i load8(const unsigned char* data) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)));
+}
+
+// roundSaturate on eight lanes
+AVX2_TARGET static inline void store8(unsigned char* data, __m256 value) {
+    __m256 truncated = _mm256_round_ps(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256 roundUp = _mm256_and_ps(_mm256_cmp_ps(_mm256_sub_ps(value, truncated), _mm256_set1_ps(0.5f), _CMP_GE_OQ), _mm256_set1_ps(1.0f));
+    __m256 rounded = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(truncated, roundUp), _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+
+    __m256i integers = _mm256_cvtps_epi32(rounded);
+    __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(integers), _mm256_extracti128_si256(integers, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(data), _mm_packus_epi16(words, words));
+}
+
+// two RGBA pixels per vector, the alpha lanes are broadcast and divided out of the color lanes
+AVX2_TARGET static inline __m256 unpremultiply8(__m256 blur) {
+    __m256 alpha = _mm256_permute_ps(blur, _MM_SHUFFLE(3, 3, 3, 3));
+    __m256 scale = _mm256_and_ps(_mm256_div_ps(_mm256_set1_ps(255.0f), alpha), _mm256_cmp_ps(alpha, _mm256_set1_ps(0.5f), _CMP_GE_OQ));
+    return _mm256_blend_ps(_mm256_mul_ps(blur, scale), blur, 0x88);
+}
+
+AVX2_TARGET static void blurRowAvx2(const unsigned char* center, unsigned char* out, size_t count, int stride, const float* weights, int radius, bool unpremultiply) {
+    const size_t width = 8;
+    size_t k = 0;
+
+    for (; k + unroll * width <= count; k += unroll * width) {
+        __m256 blur[unroll];
+        for (int u = 0; u < unroll; u++)
+            blur[u] = _mm256_mul_ps(_mm256_cvtepi32_ps(load8(center + k + u * width)), _mm256_set1_ps(weights[0]));
+
+        for (int i = 1; i <= radius; i++) {
+            __m256 weight = _mm256_set1_ps(weights[i]);
+            const unsigned char* left = center + k - (size_t)i * stride;
+            const unsigned char* right = center + k + (size_t)i * stride;
+            for (int u = 0; u < unroll; u++) {
+                __m256i taps = _mm256_add_epi32(load8(left + u * width), load8(right + u * width));
+                blur[u] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(taps), weight, blur[u]);
+            }
+        }
+
+        for (int u = 0; u < unroll; u++)
+            store8(out + k + u * width, unpremultiply ? unpremultiply8(blur[u]) : blur[u]);
+    }
+
+    blurRowReference<float, true>(center, out, count, stride, weights, radius, unpremultiply, k);
+}
+
+AVX2_TARGET static void blurColumnAvx2(const unsigned char* const* rows, unsigned char* out, size_t count, const float* weights, int radius, bool unpremultiply) {
+    const unsigned char* const* center = rows + radius;
+    const size_t width = 8;
+    size_t k = 0;
+
+    for (; k + unroll * width <= count; k += unroll * width) {
+        __m256 blur[unroll];
+        for (int u = 0; u < unroll; u++)
+            blur[u] = _mm256_mul_ps(_mm256_cvtepi32_ps(load8(center[0] + k + u * width)), _mm256_set1_ps(weights[0]));
+
+        for (int i = 1; i <= radius; i++) {
+            __m256 weight = _mm256_set1_ps(weights[i]);
+            for (int u = 0; u < unroll; u++) {
+                __m256i taps = _mm256_add_epi32(load8(center[-i] + k + u * width), load8(center[i] + k + u * width));
+                blur[u] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(taps), weight, blur[u]);
+            }
+        }
+
+        for (int u = 0; u < unroll; u++)
+            store8(out + k + u * width, unpremultiply ? unpremultiply8(blur[u]) : blur[u]);
+    }
+
+    blurColumnReference<float, true>(rows, out, count, weights, radius, unpremultiply, k);
+}
+
+// sixteen 8 bit values widened to 16 bits
+AVX2_TARGET static inline __m256i load16Words(const unsigned char* data) {
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+}
+
+// Adds the taps a and b of two distances times their weights to 32 bit sums, interleaving the taps
+// lets one multiply-add cover both distances. The unpacks work per 128 bit lane, so low holds the
+// values 0-3 and 8-11 and high the values 4-7 and 12-15.
+AVX2_TARGET static inline void multiplyAddPair(__m256i a, __m256i b, short weightA, short weightB, __m256i& low, __m256i& high) {
+    __m256i weights = _mm256_set1_epi32((int)(unsigned short)weightA | ((int)weightB << 16));
+    low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weights));
+    high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weights));
+}
+
+// the integer unpremultiply of finishFixedPixel on the two whole pixels of a vector
+AVX2_TARGET static inline __m256i unpremultiplyFixed8(__m256i sums) {
+    __m256i alpha = _mm256_shuffle_epi32(sums, _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i numerators = _mm256_add_epi32(_mm256_mullo_epi32(sums, _mm256_set1_epi32(510)), alpha);
+    __m256i divisors = _mm256_add_epi32(alpha, alpha);
+
+    __m128i first = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(numerators)), _mm256_cvtepi32_pd(_mm256_castsi256_si128(divisors))));
+    __m128i second = _mm256_cvttpd_epi32(_mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(numerators, 1)), _mm256_cvtepi32_pd(_mm256_extracti128_si256(divisors, 1))));
+    __m256i colors = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+
+    colors = _mm256_and_si256(colors, _mm256_cmpgt_epi32(alpha, _mm256_set1_epi32((1 << (fixedPointBits - 1)) - 1)));
+    __m256i rounded = _mm256_srai_epi32(_mm256_add_epi32(sums, _mm256_set1_epi32(1 << (fixedPointBits - 1))), fixedPointBits);
+    return _mm256_blend_epi32(colors, rounded, 0x88);
+}
+
+// storeFixed8 of the SSE 4.1 kernels on sixteen channels
+AVX2_TARGET static inline void storeFixed16(unsigned char* data, __m256i low, __m256i high, bool unpremultiply) {
+    if (unpremultiply) {
+        low = unpremultiplyFixed8(low);
+        high = unpremultiplyFixed8(high);
+    } else {
+        __m256i half = _mm256_set1_epi32(1 << (fixedPointBits - 1));
+        low = _mm256_srai_epi32(_mm256_add_epi32(low, half), fixedPointBits);
+        high = _mm256_srai_epi32(_mm256_add_epi32(high, half), fixedPointBits);
+    }
+
+    // the pack works per lane as well and puts the values back in order
+    __m256i words = _mm256_packus_epi32(low, high);
+    __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data), bytes);
+}
+
+// the taps at distance i of sixteen channels, like rowTaps8 of the SSE 4.1 kernels
+AVX2_TARGET static inline __m256i rowTaps16(const unsigned char* center, int stride, int i) {
+    if (i == 0)
+        return load16Words(center);
+    return _mm256_add_epi16(load16Words(center - (size_t)i * stride), load16Words(center + (size_t)i * stride));
+}
+
+AVX2_TARGET static inline __m256i columnTaps16(const unsigned char* const* center, size_t k, int i) {
+    if (i == 0)
+        return load16Words(center[0] + k);
+    return _mm256_add_epi16(load16Words(center[-i] + k), load16Words(center[i] + k));
+}
+
+AVX2_TARGET static void blurRowFixedAvx2(const unsigned char* center, unsigned char* out, size_t count, int stride, const short* weights, int radius, bool unpremultiply) {
+    const size_t width = 16;
+    size_t k = 0;
+
+    for (; k + width <= count; k += width) {
+        // two distances per multiply-add like the SSE 4.1 kernel
+        __m256i low = _mm256_setzero_si256();
+        __m256i high = _mm256_setzero_si256();
+        for (int i = 0; i <= radius; i += 2) {
+            __m256i next = i < radius ? rowTaps16(center + k, stride, i + 1) : _mm256_setzero_si256();
+            multiplyAddPair(rowTaps16(center + k, stride, i), next, weights[i], i < radius ? weights[i + 1] : 0, low, high);
+        }
+        storeFixed16(out + k, low, high, unpremultiply);
+    }
+
+    blurRowFixedReference(center, out, count, stride, weights, radius, unpremultiply, k);
+}
+
+AVX2_TARGET static void blurColumnFixedAvx2(const unsigned char* const* rows, unsigned char* out, size_t count, const short* weights, int radius, bool unpremultiply) {
+    const unsigned char* const* center = rows + radius;
+    const size_t width = 16;
+    size_t k = 0;
+
+    for (; k + width <= count; k += width) {
+        __m256i low = _mm256_setzero_si256();
+        __m256i high = _mm256_setzero_si256();
+        for (int i = 0; i <= radius; i += 2) {
+            __m256i next = i < radius ? columnTaps16(center, k, i + 1) : _mm256_setzero_si256();
+            multiplyAddPair(columnTaps16(center, k, i), next, weights[i], i < radius ? weights[i + 1] : 0, low, high);
+        }
+        storeFixed16(out + k, low, high, unpremultiply);
+    }
+
+    blurColumnFixedReference(rows, out, count, weights, radius, unpremultiply, k);
+}
+
+// RGBA shuffles 32 bytes at a time. The 128 bit lanes of the byte shuffle do not line up with
+// RGB pixels, those take the 16 byte steps of the SSE4.1 kernel, five pixels at a time.
+AVX2_TARGET void swapRedBlueAvx2(const unsigned char* source, unsigned char* target, size_t pixels, int bytesPerPixel) {
+    size_t size = pixels * bytesPerPixel;
+    size_t k = 0;
+    if (bytesPerPixel == 4) {
+        __m256i order = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                         2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        for (; k + 32 <= size; k += 32) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + k));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + k), _mm256_shuffle_epi8(bytes, order));
+        }
+    } else {
+        __m128i order = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+        for (; k + 16 <= size; k += 15) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + k));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target + k), _mm_shuffle_epi8(bytes, order));
+        }
+    }
+
+    swapRedBlueReference(source, target, pixels, bytesPerPixel, k / bytesPerPixel);
+}
+
+static const CpuKernels kernels = { CpuIsa::Avx2, blurRowAvx2, blurColumnAvx2, blurRowFixedAvx2, blurColumnFixedAvx2, swapRedBlueAvx2 };
+
+const CpuKernels* avx2Kernels() {
+    return &kernels;
+}
+#else
+const CpuKernels* avx2Kernels() {
+    return NULL;
+}
+#endif
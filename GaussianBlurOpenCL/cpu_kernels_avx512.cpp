@@ -0,0 +1,171 @@
+#include "cpu_kernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+#define AVX512_TARGET __attribute__((target("avx512f")))
+#else
+#define AVX512_TARGET
+#endif
+
+// accumulators per iteration, as many as in the AVX2 kernels
+static const int unroll = 4;
+
+AVX512_TARGET static inline __m512i load16(const unsigned char* data) {
+    return _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+}
+
+// roundSaturate on sixteen lanes
+AVX512_TARGET static inline void store16(unsigned char* data, __m512 value) {
+    __m512 truncated = _mm512_roundscale_ps(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __mmask16 roundUp = _mm512_cmp_ps_mask(_mm512_sub_ps(value, truncated), _mm512_set1_ps(0.5f), _CMP_GE_OQ);
+    __m512 rounded = _mm512_mask_add_ps(truncated, roundUp, truncated, _mm512_set1_ps(1.0f));
+    rounded = _mm512_min_ps(_mm512_max_ps(rounded, _mm512_setzero_ps()), _mm512_set1_ps(255.0f));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data), _mm512_cvtusepi32_epi8(_mm512_cvtps_epi32(rounded)));
+}
+
+// four RGBA pixels per vector, the alpha lanes are broadcast and divided out of the color lanes
+AVX512_TARGET static inline __m512 unpremultiply16(__m512 blur) {
+    __m512 alpha = _mm512_permute_ps(blur, _MM_SHUFFLE(3, 3, 3, 3));
+    __mmask16 opaque = _mm512_cmp_ps_mask(alpha, _mm512_set1_ps(0.5f), _CMP_GE_OQ);
+    __m512 scale = _mm512_maskz_div_ps(opaque, _mm512_set1_ps(255.0f), alpha);
+    return _mm512_mask_blend_ps(0x8888, _mm512_mul_ps(blur, scale), blur);
+}
+
+AVX512_TARGET static void blurRowAvx512(const unsigned char* center, unsigned char* out, size_t count, int stride, const float* weights, int radius, bool unpremultiply) {
+    const size_t width = 16;
+    size_t k = 0;
+
+    for (; k + unroll * width <= count; k += unroll * width) {
+        __m512 blur[unroll];
+        for (int u = 0; u < unroll; u++)
+            blur[u] = _mm512_mul_ps(_mm512_cvtepi32_ps(load16(center + k + u * width)), _mm512_set1_ps(weights[0]));
+
+        for (int i = 1; i <= radius; i++) {
+            __m512 weight = _mm512_set1_ps(weights[i]);
+            const unsigned char* left = center + k - (size_t)i * stride;
+            const unsigned char* right = center + k + (size_t)i * stride;
+            for (int u = 0; u < unroll; u++) {
+                __m512i taps = _mm512_add_epi32(load16(left + u * width), load16(right + u * width));
+                blur[u] = _mm512_fmadd_ps(_mm512_cvtepi32_ps(taps), weight, blur[u]);
+            }
+        }
+
+        for (int u = 0; u < unroll; u++)
+            store16(out + k + u * width, unpremultiply ? unpremultiply16(blur[u]) : blur[u]);
+    }
+
+    blurRowReference<float, true>(center, out, count, stride, weights, radius, unpremultiply, k);
+}
+
+AVX512_TARGET static void blurColumnAvx512(const unsigned char* const* rows, unsigned char* out, size_t count, const float* weights, int radius, bool unpremultiply) {
+    const unsigned char* const* center = rows + radius;
+    const size_t width = 16;
+    size_t k = 0;
+
+    for (; k + unroll * width <= count; k += unroll * width) {
+        __m512 blur[unroll];
+        for (int u = 0; u < unroll; u++)
+            blur[u] = _mm512_mul_ps(_mm512_cvtepi32_ps(load16(center[0] + k + u * width)), _mm512_set1_ps(weights[0]));
+
+        for (int i = 1; i <= radius; i++) {
+            __m512 weight = _mm512_set1_ps(weights[i]);
+            for (int u = 0; u < unroll; u++) {
+                __m512i taps = _mm512_add_epi32(load16(center[-i] + k + u * width), load16(center[i] + k + u * width));
+                blur[u] = _mm512_fmadd_ps(_mm512_cvtepi32_ps(taps), weight, blur[u]);
+            }
+        }
+
+        for (int u = 0; u < unroll; u++)
+            store16(out + k + u * width, unpremultiply ? unpremultiply16(blur[u]) : blur[u]);
+    }
+
+    blurColumnReference<float, true>(rows, out, count, weights, radius, unpremultiply, k);
+}
+
+// the integer unpremultiply of finishFixedPixel on four whole pixels
+AVX512_TARGET static inline __m512i unpremultiplyFixed16(__m512i sums) {
+    __m512i alpha = _mm512_shuffle_epi32(sums, _MM_PERM_DDDD);
+    __m512i numerators = _mm512_add_epi32(_mm512_mullo_epi32(sums, _mm512_set1_epi32(510)), alpha);
+    __m512i divisors = _mm512_add_epi32(alpha, alpha);
+
+    __m256i first = _mm512_cvttpd_epi32(_mm512_div_pd(_mm512_cvtepi32_pd(_mm512_castsi512_si256(numerators)), _mm512_cvtepi32_pd(_mm512_castsi512_si256(divisors))));
+    __m256i second = _mm512_cvttpd_epi32(_mm512_div_pd(_mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(numerators, 1)), _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(divisors, 1))));
+    __m512i colors = _mm512_inserti64x4(_mm512_castsi256_si512(first), second, 1);
+
+    __mmask16 opaque = _mm512_cmpge_epi32_mask(alpha, _mm512_set1_epi32(1 << (fixedPointBits - 1)));
+    __m512i rounded = _mm512_srai_epi32(_mm512_add_epi32(sums, _mm512_set1_epi32(1 << (fixedPointBits - 1))), fixedPointBits);
+    return _mm512_mask_blend_epi32(0x8888, _mm512_maskz_mov_epi32(opaque, colors), rounded);
+}
+
+// roundFixed on sixteen lanes, the narrowing saturates
+AVX512_TARGET static inline void storeFixed16(unsigned char* data, __m512i blur, bool unpremultiply) {
+    __m512i rounded = unpremultiply ? unpremultiplyFixed16(blur) : _mm512_srai_epi32(_mm512_add_epi32(blur, _mm512_set1_epi32(1 << (fixedPointBits - 1))), fixedPointBits);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data), _mm512_cvtusepi32_epi8(rounded));
+}
+
+// AVX-512 F has no 16 bit multiply-add and its 32 bit multiply is slow, so the integer sums are
+// built with float multiply-adds instead. Every product and partial sum is an integer below
+// 255 * 2^14 < 2^24, which float holds exactly, so the result is the same as in integers.
+AVX512_TARGET static void blurRowFixedAvx512(const unsigned char* center, unsigned char* out, size_t count, int stride, const short* weights, int radius, bool unpremultiply) {
+    const size_t width = 16;
+    size_t k = 0;
+
+    for (; k + unroll * width <= count; k += unroll * width) {
+        __m512 blur[unroll];
+        for (int u = 0; u < unroll; u++)
+            blur[u] = _mm512_mul_ps(_mm512_cvtepi32_ps(load16(center + k + u * width)), _mm512_set1_ps(weights[0]));
+
+        for (int i = 1; i <= radius; i++) {
+            __m512 weight = _mm512_set1_ps(weights[i]);
+            const unsigned char* left = center + k - (size_t)i * stride;
+            const unsigned char* right = center + k + (size_t)i * stride;
+            for (int u = 0; u < unroll; u++) {
+                __m512i taps = _mm512_add_epi32(load16(left + u * width), load16(right + u * width));
+                blur[u] = _mm512_fmadd_ps(_mm512_cvtepi32_ps(taps), weight, blur[u]);
+            }
+        }
+
+        for (int u = 0; u < unroll; u++)
+            storeFixed16(out + k + u * width, _mm512_cvtps_epi32(blur[u]), unpremultiply);
+    }
+
+    blurRowFixedReference(center, out, count, stride, weights, radius, unpremultiply, k);
+}
+
+AVX512_TARGET static void blurColumnFixedAvx512(const unsigned char* const* rows, unsigned char* out, size_t count, const short* weights, int radius, bool unpremultiply) {
+    const unsigned char* const* center = rows + radius;
+    const size_t width = 16;
+    size_t k = 0;
+
+    for (; k + unroll * width <= count; k += unroll * width) {
+        __m512 blur[unroll];
+        for (int u = 0; u < unroll; u++)
+            blur[u] = _mm512_mul_ps(_mm512_cvtepi32_ps(load16(center[0] + k + u * width)), _mm512_set1_ps(weights[0]));
+
+        for (int i = 1; i <= radius; i++) {
+            __m512 weight = _mm512_set1_ps(weights[i]);
+            for (int u = 0; u < unroll; u++) {
+                __m512i taps = _mm512_add_epi32(load16(center[-i] + k + u * width), load16(center[i] + k + u * width));
+                blur[u] = _mm512_fmadd_ps(_mm512_cvtepi32_ps(taps), weight, blur[u]);
+            }
+        }
+
+        for (int u = 0; u < unroll; u++)
+            storeFixed16(out + k + u * width, _mm512_cvtps_epi32(blur[u]), unpremultiply);
+    }
+
+    blurColumnFixedReference(rows, out, count, weights, radius, unpremultiply, k);
+}
+
+static const CpuKernels kernels = { CpuIsa::Avx512, blurRowAvx512, blurColumnAvx512, blurRowFixedAvx512, blurColumnFixedAvx512, swapRedBlueAvx2 };
+
+const CpuKernels* avx512Kernels() {
+    return &kernels;
+}
+#else
+const CpuKernels* avx512Kernels() {
+    return NULL;
+}
+#endif
@@ -0,0 +1,209 @@
+#include "cpu_kernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <cstring>
+#include <smmintrin.h>
+
+#if defined(__GNUC__)
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+#else
+#define SSE41_TARGET
+#endif
+
+// independent accumulators per iteration, enough to hide the latency of the adds
+static const int unroll = 4;
+
+SSE41_TARGET static inline __m128i load4(const unsigned char* data) {
+    int value;
+    memcpy(&value, data, sizeof(value));
+    return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(value));
+}
+
+// roundSaturate on four lanes
+SSE41_TARGET static inline void store4(unsigned char* data, __m128 value) {
+    __m128 truncated = _mm_round_ps(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m128 roundUp = _mm_and_ps(_mm_cmpge_ps(_mm_sub_ps(value, truncated), _mm_set1_ps(0.5f)), _mm_set1_ps(1.0f));
+    __m128 rounded = _mm_min_ps(_mm_max_ps(_mm_add_ps(truncated, roundUp), _mm_setzero_ps()), _mm_set1_ps(255.0f));
+
+    __m128i words = _mm_packus_epi32(_mm_cvtps_epi32(rounded), _mm_setzero_si128());
+    int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+    memcpy(data, &bytes, sizeof(bytes));
+}
+
+// one RGBA pixel per vector, the alpha lane is broadcast and divided out of the color lanes
+SSE41_TARGET static inline __m128 unpremultiply4(__m128 blur) {
+    __m128 alpha = _mm_shuffle_ps(blur, blur, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 scale = _mm_and_ps(_mm_div_ps(_mm_set1_ps(255.0f), alpha), _mm_cmpge_ps(alpha, _mm_set1_ps(0.5f)));
+    return _mm_blend_ps(_mm_mul_ps(blur, scale), blur, 0x8);
+}
+
+SSE41_TARGET static void blurRowSse41(const unsigned char* center, unsigned char* out, size_t count, int stride, const float* weights, int radius, bool unpremultiply) {
+    const size_t width = 4;
+    size_t k = 0;
+
+    for (; k + unroll * width <= count; k += unroll * width) {
+        __m128 blur[unroll];
+        for (int u = 0; u < unroll; u++)
+            blur[u] = _mm_mul_ps(_mm_cvtepi32_ps(load4(center + k + u * width)), _mm_set1_ps(weights[0]));
+
+        for (int i = 1; i <= radius; i++) {
+            __m128 weight = _mm_set1_ps(weights[i]);
+            const unsigned char* left = center + k - (size_t)i * stride;
+            const unsigned char* right = center + k + (size_t)i * stride;
+            for (int u = 0; u < unroll; u++) {
+                __m128i taps = _mm_add_epi32(load4(left + u * width), load4(right + u * width));
+                blur[u] = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(taps), weight), blur[u]);
+            }
+        }
+
+        for (int u = 0; u < unroll; u++)
+            store4(out + k + u * width, unpremultiply ? unpremultiply4(blur[u]) : blur[u]);
+    }
+
+    blurRowReference<float>(center, out, count, stride, weights, radius, unpremultiply, k);
+}
+
+SSE41_TARGET static void blurColumnSse41(const unsigned char* const* rows, unsigned char* out, size_t count, const float* weights, int radius, bool unpremultiply) {
+    const unsigned char* const* center = rows + radius;
+    const size_t width = 4;
+    size_t k = 0;
+
+    for (; k + unroll * width <= count; k += unroll * width) {
+        __m128 blur[unroll];
+        for (int u = 0; u < unroll; u++)
+            blur[u] = _mm_mul_ps(_mm_cvtepi32_ps(load4(center[0] + k + u * width)), _mm_set1_ps(weights[0]));
+
+        for (int i = 1; i <= radius; i++) {
+            __m128 weight = _mm_set1_ps(weights[i]);
+            for (int u = 0; u < unroll; u++) {
+                __m128i taps = _mm_add_epi32(load4(center[-i] + k + u * width), load4(center[i] + k + u * width));
+                blur[u] = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(taps), weight), blur[u]);
+            }
+        }
+
+        for (int u = 0; u < unroll; u++)
+            store4(out + k + u * width, unpremultiply ? unpremultiply4(blur[u]) : blur[u]);
+    }
+
+    blurColumnReference<float>(rows, out, count, weights, radius, unpremultiply, k);
+}
+
+// eight 8 bit values widened to 16 bits
+SSE41_TARGET static inline __m128i load8Words(const unsigned char* data) {
+    return _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(data)));
+}
+
+// Adds the taps a and b of two distances times their weights to the 32 bit sums of the low and
+// the high four values. Interleaving the taps lets one multiply-add cover both distances.
+SSE41_TARGET static inline void multiplyAddPair(__m128i a, __m128i b, short weightA, short weightB, __m128i& low, __m128i& high) {
+    __m128i weights = _mm_set1_epi32((int)(unsigned short)weightA | ((int)weightB << 16));
+    low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weights));
+    high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weights));
+}
+
+// the integer unpremultiply of finishFixedPixel on one pixel
+SSE41_TARGET static inline __m128i unpremultiplyFixed4(__m128i sums) {
+    __m128i alpha = _mm_shuffle_epi32(sums, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i numerators = _mm_add_epi32(_mm_mullo_epi32(sums, _mm_set1_epi32(510)), alpha);
+    __m128d divisor = _mm_cvtepi32_pd(_mm_add_epi32(alpha, alpha));
+
+    __m128i first = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(numerators), divisor));
+    __m128i second = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(numerators, numerators)), divisor));
+    __m128i colors = _mm_unpacklo_epi64(first, second);
+
+    colors = _mm_and_si128(colors, _mm_cmpgt_epi32(alpha, _mm_set1_epi32((1 << (fixedPointBits - 1)) - 1)));
+    __m128i rounded = _mm_srai_epi32(_mm_add_epi32(sums, _mm_set1_epi32(1 << (fixedPointBits - 1))), fixedPointBits);
+    return _mm_blend_epi16(colors, rounded, 0xC0);
+}
+
+// rounds like roundFixed, the packs saturate to 0..255
+SSE41_TARGET static inline void storeFixed8(unsigned char* data, __m128i low, __m128i high, bool unpremultiply) {
+    if (unpremultiply) {
+        low = unpremultiplyFixed4(low);
+        high = unpremultiplyFixed4(high);
+    } else {
+        __m128i half = _mm_set1_epi32(1 << (fixedPointBits - 1));
+        low = _mm_srai_epi32(_mm_add_epi32(low, half), fixedPointBits);
+        high = _mm_srai_epi32(_mm_add_epi32(high, half), fixedPointBits);
+    }
+
+    __m128i words = _mm_packus_epi32(low, high);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(data), _mm_packus_epi16(words, words));
+}
+
+// the center alone at distance zero, the sum of both neighbours further out
+SSE41_TARGET static inline __m128i rowTaps8(const unsigned char* center, int stride, int i) {
+    if (i == 0)
+        return load8Words(center);
+    return _mm_add_epi16(load8Words(center - (size_t)i * stride), load8Words(center + (size_t)i * stride));
+}
+
+SSE41_TARGET static inline __m128i columnTaps8(const unsigned char* const* center, size_t k, int i) {
+    if (i == 0)
+        return load8Words(center[0] + k);
+    return _mm_add_epi16(load8Words(center[-i] + k), load8Words(center[i] + k));
+}
+
+SSE41_TARGET static void blurRowFixedSse41(const unsigned char* center, unsigned char* out, size_t count, int stride, const short* weights, int radius, bool unpremultiply) {
+    const size_t width = 8;
+    size_t k = 0;
+
+    for (; k + width <= count; k += width) {
+        // the distances in pairs, a last distance without partner is paired with a zero weight
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        for (int i = 0; i <= radius; i += 2) {
+            __m128i next = i < radius ? rowTaps8(center + k, stride, i + 1) : _mm_setzero_si128();
+            multiplyAddPair(rowTaps8(center + k, stride, i), next, weights[i], i < radius ? weights[i + 1] : 0, low, high);
+        }
+        storeFixed8(out + k, low, high, unpremultiply);
+    }
+
+    blurRowFixedReference(center, out, count, stride, weights, radius, unpremultiply, k);
+}
+
+SSE41_TARGET static void blurColumnFixedSse41(const unsigned char* const* rows, unsigned char* out, size_t count, const short* weights, int radius, bool unpremultiply) {
+    const unsigned char* const* center = rows + radius;
+    const size_t width = 8;
+    size_t k = 0;
+
+    for (; k + width <= count; k += width) {
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        for (int i = 0; i <= radius; i += 2) {
+            __m128i next = i < radius ? columnTaps8(center, k, i + 1) : _mm_setzero_si128();
+            multiplyAddPair(columnTaps8(center, k, i), next, weights[i], i < radius ? weights[i + 1] : 0, low, high);
+        }
+        storeFixed8(out + k, low, high, unpremultiply);
+    }
+
+    blurColumnFixedReference(rows, out, count, weights, radius, unpremultiply, k);
+}
+
+// Shuffles 16 bytes at a time, four RGBA pixels or five RGB pixels and the first byte of the
+// next one. That byte is passed through unchanged and swapped with its pixel in the next step,
+// which still reads the original since the step before only wrote it back as it was.
+SSE41_TARGET static void swapRedBlueSse41(const unsigned char* source, unsigned char* target, size_t pixels, int bytesPerPixel) {
+    size_t size = pixels * bytesPerPixel;
+    size_t step = bytesPerPixel == 4 ? 16 : 15;
+    __m128i order = bytesPerPixel == 4 ? _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)
+                                       : _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    size_t k = 0;
+    for (; k + 16 <= size; k += step) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + k));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(target + k), _mm_shuffle_epi8(bytes, order));
+    }
+
+    swapRedBlueReference(source, target, pixels, bytesPerPixel, k / bytesPerPixel);
+}
+
+static const CpuKernels kernels = { CpuIsa::Sse41, blurRowSse41, blurColumnSse41, blurRowFixedSse41, blurColumnFixedSse41, swapRedBlueSse41 };
+
+const CpuKernels* sse41Kernels() {
+    return &kernels;
+}
+#else
+const CpuKernels* sse41Kernels() {
+    return NULL;
+}
+#endif
@@ -0,0 +1,117 @@
+#include "device_info.h"
+#include <cstring>
+#include <stdio.h>
+
+static std::string deviceString(cl_device_id device, cl_device_info param) {
+    size_t size;
+    checkStatus(clGetDeviceInfo(device, param, 0, NULL, &size));
+    std::string value(size, '\0');
+    checkStatus(clGetDeviceInfo(device, param, size, &value[0], NULL));
+    value.resize(strlen(value.c_str()));
+    return value;
+}
+
+static std::string platformString(cl_platform_id platform, cl_platform_info param) {
+    size_t size;
+    checkStatus(clGetPlatformInfo(platform, param, 0, NULL, &size));
+    std::string value(size, '\0');
+    checkStatus(clGetPlatformInfo(platform, param, size, &value[0], NULL));
+    value.resize(strlen(value.c_str()));
+    return value;
+}
+
+template <typename T>
+static T deviceValue(cl_device_id device, cl_device_info param) {
+    T value = T();
+    checkStatus(clGetDeviceInfo(device, param, sizeof(T), &value, NULL));
+    return value;
+}
+
+DeviceInfo queryDeviceInfo(cl_platform_id platform, cl_device_id device) {
+    DeviceInfo info;
+    info.platform = platform;
+    info.device = device;
+
+    info.platformName = platformString(platform, CL_PLATFORM_NAME);
+    info.name = deviceString(device, CL_DEVICE_NAME);
+    info.vendor = deviceString(device, CL_DEVICE_VENDOR);
+    info.version = deviceString(device, CL_DEVICE_VERSION);
+    info.driverVersion = deviceString(device, CL_DRIVER_VERSION);
+    info.type = deviceValue<cl_device_type>(device, CL_DEVICE_TYPE);
+    info.available = deviceValue<cl_bool>(device, CL_DEVICE_AVAILABLE) == CL_TRUE;
+    info.compilerAvailable = deviceValue<cl_bool>(device, CL_DEVICE_COMPILER_AVAILABLE) == CL_TRUE;
+
+    info.computeUnits = deviceValue<cl_uint>(device, CL_DEVICE_MAX_COMPUTE_UNITS);
+    info.maxClockFrequency = deviceValue<cl_uint>(device, CL_DEVICE_MAX_CLOCK_FREQUENCY);
+    info.globalMemSize = deviceValue<cl_ulong>(device, CL_DEVICE_GLOBAL_MEM_SIZE);
+    info.maxMemAllocSize = deviceValue<cl_ulong>(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE);
+    info.maxConstantBufferSize = deviceValue<cl_ulong>(device, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE);
+    info.localMemSize = deviceValue<cl_ulong>(device, CL_DEVICE_LOCAL_MEM_SIZE);
+    info.dedicatedLocalMem = deviceValue<cl_device_local_mem_type>(device, CL_DEVICE_LOCAL_MEM_TYPE) == CL_LOCAL;
+    info.hostUnifiedMemory = deviceValue<cl_bool>(device, CL_DEVICE_HOST_UNIFIED_MEMORY) == CL_TRUE;
+
+    info.maxWorkGroupSize = deviceValue<size_t>(device, CL_DEVICE_MAX_WORK_GROUP_SIZE);
+    checkStatus(clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(info.maxWorkItemSizes), info.maxWorkItemSizes, NULL));
+
+    std::string extensions = deviceString(device, CL_DEVICE_EXTENSIONS);
+    info.fp64 = extensions.find("cl_khr_fp64") != std::string::npos;
+    info.fp16 = extensions.find("cl_khr_fp16") != std::string::npos;
+    info.preferredVectorWidthChar = deviceValue<cl_uint>(device, CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR);
+    info.preferredVectorWidthFloat = deviceValue<cl_uint>(device, CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT);
+    info.preferredVectorWidthDouble = deviceValue<cl_uint>(device, CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE);
+    info.preferredVectorWidthHalf = deviceValue<cl_uint>(device, CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF);
+    info.nativeVectorWidthHalf = deviceValue<cl_uint>(device, CL_DEVICE_NATIVE_VECTOR_WIDTH_HALF);
+
+    return info;
+}
+
+std::vector<DeviceInfo> queryAllDevices() {
+    std::vector<DeviceInfo> result;
+
+    // without any installed driver the icd loader reports an error instead of zero platforms
+    cl_uint numPlatforms = 0;
+    if (clGetPlatformIDs(0, NULL, &numPlatforms) != CL_SUCCESS || numPlatforms == 0)
+        return result;
+    std::vector<cl_platform_id> platforms(numPlatforms);
+    checkStatus(clGetPlatformIDs(numPlatforms, platforms.data(), NULL));
+
+    for (cl_uint p = 0; p < numPlatforms; p++) {
+        cl_uint numDevices = 0;
+        if (clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, 0, NULL, &numDevices) != CL_SUCCESS || numDevices == 0)
+            continue;
+        std::vector<cl_device_id> devices(numDevices);
+        checkStatus(clGetDeviceIDs(platforms[p], CL_DEVICE_TYPE_ALL, numDevices, devices.data(), NULL));
+
+        for (cl_uint d = 0; d < numDevices; d++) {
+            DeviceInfo info = queryDeviceInfo(platforms[p], devices[d]);
+            info.platformIndex = (int)p;
+            info.deviceIndex = (int)d;
+            result.push_back(info);
+        }
+    }
+    return result;
+}
+
+static const char* deviceTypeName(cl_device_type type) {
+    if (type & CL_DEVICE_TYPE_GPU) return "GPU";
+    if (type & CL_DEVICE_TYPE_CPU) return "CPU";
+    if (type & CL_DEVICE_TYPE_ACCELERATOR) return "accelerator";
+    return "other";
+}
+
+void printDeviceInfo(const DeviceInfo& info) {
+    const double MiB = 1024.0 * 1024.0;
+    printf("platform %d, device %d: %s (%s)%s\n", info.platformIndex, info.deviceIndex, info.name.c_str(), info.platformName.c_str(),
+           info.available && info.compilerAvailable ? "" : " [not usable]");
+    printf("  type:                 %s, %s\n", deviceTypeName(info.type), info.version.c_str());
+    printf("  driver:               %s\n", info.driverVersion.c_str());
+    printf("  compute units:        %u at %u MHz\n", info.computeUnits, info.maxClockFrequency);
+    printf("  global memory:        %.0f MiB, max allocation %.0f MiB\n", info.globalMemSize / MiB, info.maxMemAllocSize / MiB);
+    printf("  local memory:         %llu KiB%s\n", (unsigned long long)(info.localMemSize / 1024), info.dedicatedLocalMem ? "" : " (emulated in global memory)");
+    printf("  constant buffer:      %llu KiB\n", (unsigned long long)(info.maxConstantBufferSize / 1024));
+    printf("  work-group size:      %zu (%zu x %zu x %zu)\n", info.maxWorkGroupSize, info.maxWorkItemSizes[0], info.maxWorkItemSizes[1], info.maxWorkItemSizes[2]);
+    printf("  fp64 / fp16:          %s / %s\n", info.fp64 ? "yes" : "no", info.fp16 ? "yes" : "no");
+    printf("  unified memory:       %s\n", info.hostUnifiedMemory ? "yes" : "no");
+    printf("  vector widths:        char %u, float %u, double %u, half %u\n", info.preferredVectorWidthChar, info.preferredVectorWidthFloat,
+           info.preferredVectorWidthDouble, info.preferredVectorWidthHalf);
+}
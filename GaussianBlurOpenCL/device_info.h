@@ -0,0 +1,54 @@
+#ifndef GAUSSIAN_BLUR_DEVICE_INFO_H
+#define GAUSSIAN_BLUR_DEVICE_INFO_H
+
+#include <string>
+#include <vector>
+#include "cl_utils.h"
+
+// the capabilities of an OpenCL device that decide how the blur runs on it
+struct DeviceInfo {
+    int platformIndex = 0;
+    int deviceIndex = 0;
+    cl_platform_id platform = NULL;
+    cl_device_id device = NULL;
+
+    std::string platformName;
+    std::string name;
+    std::string vendor;
+    std::string version;
+    std::string driverVersion;
+    cl_device_type type = 0;
+    bool available = false;
+    bool compilerAvailable = false;
+
+    cl_uint computeUnits = 0;
+    cl_uint maxClockFrequency = 0;
+    cl_ulong globalMemSize = 0;
+    cl_ulong maxMemAllocSize = 0;
+    cl_ulong maxConstantBufferSize = 0;
+    cl_ulong localMemSize = 0;
+    // local memory that is only emulated in global memory does not make tiles any faster
+    bool dedicatedLocalMem = false;
+    bool hostUnifiedMemory = false;
+
+    size_t maxWorkGroupSize = 0;
+    size_t maxWorkItemSizes[3] = { 0, 0, 0 };
+
+    bool fp64 = false;
+    bool fp16 = false;
+    cl_uint preferredVectorWidthChar = 0;
+    cl_uint preferredVectorWidthFloat = 0;
+    cl_uint preferredVectorWidthDouble = 0;
+    cl_uint preferredVectorWidthHalf = 0;
+    cl_uint nativeVectorWidthHalf = 0;
+};
+
+DeviceInfo queryDeviceInfo(cl_platform_id platform, cl_device_id device);
+
+// all devices of all platforms, an empty list if no OpenCL driver is installed
+std::vector<DeviceInfo> queryAllDevices();
+
+// the capability report of --list-devices
+void printDeviceInfo(const DeviceInfo& info);
+
+#endif //GAUSSIAN_BLUR_DEVICE_INFO_H
@@ -0,0 +1,213 @@
+#include "device_scheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+// a strip needs at least this many rows of its own to be worth a device
+static const int minStripHeight = 64;
+
+// the image that measures a device before its first strip
+static const int calibrationMaxWidth = 1024;
+static const int calibrationHeight = 256;
+
+DeviceScheduler::DeviceScheduler(const EngineOptions& options, EngineType type, bool allDevices, const CpuEngineOptions& cpuOptions) {
+    if (type == EngineType::Auto) {
+        bool usable = false;
+        for (const DeviceInfo& info : queryAllDevices())
+            usable = usable || (info.available && info.compilerAvailable);
+        if (!usable)
+            printf("No usable OpenCL device available, falling back to the cpu engine\n");
+        type = usable ? EngineType::OpenCL : EngineType::Cpu;
+    }
+
+    if (type == EngineType::Cpu) {
+        Device device;
+        device.engine.reset(new CpuBlurEngine(cpuOptions));
+        devices.push_back(std::move(device));
+        return;
+    }
+
+    if (!allDevices) {
+        Device device;
+        device.engine.reset(new BlurEngine(options));
+        devices.push_back(std::move(device));
+        return;
+    }
+
+    for (const DeviceInfo& info : queryAllDevices()) {
+        if (!info.available || !info.compilerAvailable)
+            continue;
+
+        EngineOptions deviceOptions = options;
+        deviceOptions.platformIndex = info.platformIndex;
+        deviceOptions.deviceIndex = info.deviceIndex;
+
+        Device device;
+        device.engine.reset(new BlurEngine(deviceOptions));
+        devices.push_back(std::move(device));
+    }
+
+    if (devices.empty()) {
+        printf("Error: No usable OpenCL device available!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+Precision DeviceScheduler::preferredPrecision() const {
+    for (const Device& device : devices)
+        if (device.engine->preferredPrecision() != Precision::Half)
+            return Precision::Float;
+    return Precision::Half;
+}
+
+std::vector<BlurBackend*> DeviceScheduler::engines(Precision precision) const {
+    std::vector<BlurBackend*> result;
+    for (const Device& device : devices)
+        if (device.engine->supportsPrecision(precision))
+            result.push_back(device.engine.get());
+    return result;
+}
+
+bool DeviceScheduler::supportsPrecision(Precision precision) const {
+    return !engines(precision).empty();
+}
+
+void DeviceScheduler::measured(Device& device, double pixels, double seconds) {
+    if (seconds <= 0.0)
+        return;
+
+    // a moving average follows changing image sizes without jumping on a single outlier
+    double pixelsPerSecond = pixels / seconds;
+    if (device.pixelsPerSecond == 0.0)
+        device.pixelsPerSecond = pixelsPerSecond;
+    else
+        device.pixelsPerSecond = 0.5 * (device.pixelsPerSecond + pixelsPerSecond);
+}
+
+void DeviceScheduler::calibrate(Device& device, int width, int channels, int kernelSize, double sigma, Precision precision, BlurMethod method) {
+    tga::TGAImage sample;
+    sample.bpp = channels * 8;
+    sample.type = 0;
+    sample.width = std::min(width, calibrationMaxWidth);
+    sample.height = calibrationHeight;
+    sample.imageData.resize((size_t)sample.width * sample.height * channels);
+    for (size_t i = 0; i < sample.imageData.size(); i++)
+        sample.imageData[i] = (unsigned char)(i * 7);
+
+    // the first run builds the program and allocates the buffers, only the second one is timed
+    device.engine->blur(sample, kernelSize, sigma, precision, method);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    device.engine->blur(sample, kernelSize, sigma, precision, method);
+    auto end = std::chrono::high_resolution_clock::now();
+    measured(device, (double)sample.width * sample.height, std::chrono::duration<double>(end - start).count());
+}
+
+void DeviceScheduler::blur(tga::TGAImage& image, int kernelSize, double sigma, Precision precision, BlurMethod method) {
+    std::vector<Device*> candidates;
+    for (Device& device : devices)
+        if (device.engine->supportsPrecision(precision))
+            candidates.push_back(&device);
+
+    if (candidates.empty()) {
+        printf("Error: No device supports the requested precision!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int channels = image.bpp / 8;
+    int radius = blurRadius(method, kernelSize, sigma);
+    int height = (int)image.height;
+    size_t rowSize = (size_t)image.width * channels;
+
+    if (candidates.size() > 1) {
+        for (Device* device : candidates)
+            if (device->pixelsPerSecond == 0.0)
+                calibrate(*device, (int)image.width, channels, kernelSize, sigma, precision, method);
+
+        // a strip thinner than its halo spends more time on the halo than on its own rows,
+        // drop the slowest devices until every strip is tall enough
+        int minStripRows = std::max(minStripHeight, 2 * radius);
+        std::sort(candidates.begin(), candidates.end(), [](const Device* a, const Device* b) { return a->pixelsPerSecond > b->pixelsPerSecond; });
+        while (candidates.size() > 1) {
+            double total = 0.0;
+            for (Device* device : candidates)
+                total += device->pixelsPerSecond;
+            if (height * candidates.back()->pixelsPerSecond / total >= minStripRows)
+                break;
+            candidates.pop_back();
+        }
+    }
+
+    if (candidates.size() == 1) {
+        auto start = std::chrono::high_resolution_clock::now();
+        candidates[0]->engine->blur(image, kernelSize, sigma, precision, method);
+        auto end = std::chrono::high_resolution_clock::now();
+        measured(*candidates[0], (double)image.width * image.height, std::chrono::duration<double>(end - start).count());
+        return;
+    }
+
+    // every device gets a share of the rows that matches its share of the total throughput
+    double total = 0.0;
+    for (Device* device : candidates)
+        total += device->pixelsPerSecond;
+
+    std::vector<int> bounds(1, 0);
+    double cumulative = 0.0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        cumulative += candidates[i]->pixelsPerSecond;
+        bounds.push_back(i + 1 == candidates.size() ? height : (int)std::lround(height * cumulative / total));
+    }
+
+    // cut out all strips before any device writes back, the halo rows overlap the neighbouring strips.
+    // Pixels outside the image are clamped to the edge, so radius rows of halo give the vertical pass
+    // the same neighbours it sees in the whole image.
+    std::vector<tga::TGAImage> strips(candidates.size());
+    std::vector<int> haloTops(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        int haloTop = std::max(bounds[i] - radius, 0);
+        int haloBottom = std::min(bounds[i + 1] + radius, height);
+        haloTops[i] = haloTop;
+
+        tga::TGAImage& strip = strips[i];
+        strip.bpp = image.bpp;
+        strip.type = image.type;
+        strip.width = image.width;
+        strip.height = haloBottom - haloTop;
+        strip.imageData.assign(image.data() + haloTop * rowSize, image.data() + haloBottom * rowSize);
+    }
+
+    // every engine is driven by its own thread, so the devices run at the same time
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        threads.emplace_back([&, i]() {
+            auto start = std::chrono::high_resolution_clock::now();
+            candidates[i]->engine->blur(strips[i], kernelSize, sigma, precision, method);
+            auto end = std::chrono::high_resolution_clock::now();
+            measured(*candidates[i], (double)strips[i].width * strips[i].height, std::chrono::duration<double>(end - start).count());
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    // put the rows each strip owns back into the image
+    for (size_t i = 0; i < candidates.size(); i++) {
+        auto first = strips[i].imageData.begin() + (bounds[i] - haloTops[i]) * rowSize;
+        auto last = strips[i].imageData.begin() + (bounds[i + 1] - haloTops[i]) * rowSize;
+        std::copy(first, last, image.data() + bounds[i] * rowSize);
+    }
+}
+
+void DeviceScheduler::convolve(tga::TGAImage& image, const Kernel2D& kernel, const ConvolutionPlan& plan, Precision precision) {
+    Device* fastest = nullptr;
+    for (Device& device : devices)
+        if (device.engine->supportsPrecision(precision) && (!fastest || device.pixelsPerSecond > fastest->pixelsPerSecond))
+            fastest = &device;
+
+    if (!fastest) {
+        printf("Error: No device supports the requested precision!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    fastest->engine->convolve(image, kernel, plan, precision);
+}
@@ -0,0 +1,62 @@
+#ifndef GAUSSIAN_BLUR_DEVICE_SCHEDULER_H
+#define GAUSSIAN_BLUR_DEVICE_SCHEDULER_H
+
+#include <memory>
+#include <vector>
+#include "blur_engine.h"
+#include "cpu_engine.h"
+
+// which backend blurs the images, auto falls back to the cpu when there is no usable OpenCL device
+enum class EngineType {
+    Auto,
+    OpenCL,
+    Cpu
+};
+
+// Spreads the blur over several OpenCL devices, each driven by its own BlurEngine. A single
+// image is cut into horizontal strips whose heights follow the measured throughput of the
+// devices, batches hand whole images to whichever device is free next.
+class DeviceScheduler {
+public:
+    // opens every usable device of every platform, or only the one selected in the options.
+    // The cpu engine is used on its own.
+    DeviceScheduler(const EngineOptions& options, EngineType type, bool allDevices, const CpuEngineOptions& cpuOptions = CpuEngineOptions());
+
+    DeviceScheduler(const DeviceScheduler&) = delete;
+    DeviceScheduler& operator=(const DeviceScheduler&) = delete;
+
+    // blurs the image in place, strips of it run on all devices that support the precision at the same time
+    void blur(tga::TGAImage& image, int kernelSize, double sigma, Precision precision = Precision::Float, BlurMethod method = BlurMethod::Exact);
+
+    // A 2D convolution does not split into strips as cheaply as the blur, the halo is the whole
+    // kernel. It runs on the fastest measured device that supports the precision.
+    void convolve(tga::TGAImage& image, const Kernel2D& kernel, const ConvolutionPlan& plan, Precision precision = Precision::Float);
+
+    // the engines that can compute in the precision, batch mode keeps all of them busy
+    std::vector<BlurBackend*> engines(Precision precision) const;
+
+    // true if at least one device supports the precision
+    bool supportsPrecision(Precision precision) const;
+
+    // half only if every device computes it natively
+    Precision preferredPrecision() const;
+
+    int deviceCount() const { return (int)devices.size(); }
+    BlurBackend& engine(int index) const { return *devices[index].engine; }
+
+    // measured throughput in pixels per second, zero until the device has blurred something
+    double throughput(int index) const { return devices[index].pixelsPerSecond; }
+
+private:
+    struct Device {
+        std::unique_ptr<BlurBackend> engine;
+        double pixelsPerSecond = 0.0;
+    };
+
+    void calibrate(Device& device, int width, int channels, int kernelSize, double sigma, Precision precision, BlurMethod method);
+    void measured(Device& device, double pixels, double seconds);
+
+    std::vector<Device> devices;
+};
+
+#endif //GAUSSIAN_BLUR_DEVICE_SCHEDULER_H
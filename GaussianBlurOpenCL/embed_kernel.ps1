@@ -0,0 +1,35 @@
+# Turns an OpenCL source file into a C++ header with the source as a null terminated byte
+# array, so the executable does not have to find the .cl file at runtime.
+# A byte array is used instead of a string literal because MSVC limits the length of those.
+param(
+    [Parameter(Mandatory = $true)][string]$Source,
+    [Parameter(Mandatory = $true)][string]$Output,
+    [Parameter(Mandatory = $true)][string]$Name
+)
+
+$Source = [System.IO.Path]::GetFullPath((Join-Path (Get-Location) $Source))
+$Output = [System.IO.Path]::GetFullPath((Join-Path (Get-Location) $Output))
+$bytes = [System.IO.File]::ReadAllBytes($Source)
+$guard = 'GAUSSIAN_BLUR_' + ([System.IO.Path]::GetFileName($Output) -replace '[^A-Za-z0-9]', '_').ToUpper()
+
+$builder = New-Object System.Text.StringBuilder
+[void]$builder.AppendLine("// generated from $([System.IO.Path]::GetFileName($Source)) by embed_kernel.ps1, do not edit")
+[void]$builder.AppendLine("#ifndef $guard")
+[void]$builder.AppendLine("#define $guard")
+[void]$builder.AppendLine()
+[void]$builder.AppendLine("static const unsigned char $Name[] = {")
+for ($i = 0; $i -lt $bytes.Length; $i++) {
+    if ($i % 16 -eq 0) { [void]$builder.Append('    ') }
+    [void]$builder.Append(('0x{0:x2},' -f $bytes[$i]))
+    if ($i % 16 -eq 15) { [void]$builder.AppendLine() } else { [void]$builder.Append(' ') }
+}
+[void]$builder.AppendLine('0x00')
+[void]$builder.AppendLine('};')
+[void]$builder.AppendLine()
+[void]$builder.AppendLine("#endif //$guard")
+
+$directory = [System.IO.Path]::GetDirectoryName($Output)
+if (-not (Test-Path $directory)) {
+    New-Item -ItemType Directory -Path $directory | Out-Null
+}
+[System.IO.File]::WriteAllText($Output, $builder.ToString())
@@ -0,0 +1,69 @@
+#include "fft.h"
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <utility>
+
+template <typename Real>
+FftPlan<Real>::FftPlan(int size) : n(size), reversed(size), twiddles(size / 2) {
+    int bits = 0;
+    while ((1 << bits) < n)
+        bits++;
+
+    for (int i = 0; i < n; i++) {
+        int r = 0;
+        for (int b = 0; b < bits; b++)
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        reversed[i] = r;
+    }
+
+    // computed in double, so float plans get correctly rounded twiddles
+    for (int k = 0; k < n / 2; k++) {
+        double angle = -2.0 * M_PI * k / n;
+        twiddles[k] = std::complex<Real>((Real)cos(angle), (Real)sin(angle));
+    }
+}
+
+template <typename Real>
+void FftPlan<Real>::transform(std::complex<Real>* data, size_t stride, bool inverse) const {
+    for (int i = 0; i < n; i++) {
+        if (reversed[i] > i)
+            std::swap(data[i * stride], data[reversed[i] * stride]);
+    }
+
+    // the butterflies of a stage of length len use every n / len-th twiddle
+    for (int len = 2; len <= n; len <<= 1) {
+        int half = len / 2;
+        int step = n / len;
+        for (int start = 0; start < n; start += len) {
+            for (int k = 0; k < half; k++) {
+                std::complex<Real> w = twiddles[k * step];
+                if (inverse)
+                    w = std::conj(w);
+                std::complex<Real>& a = data[(start + k) * stride];
+                std::complex<Real>& b = data[(start + k + half) * stride];
+                std::complex<Real> product = complexMultiply(b, w);
+                b = a - product;
+                a += product;
+            }
+        }
+    }
+}
+
+template <typename Real>
+void FftPlan<Real>::transform2d(std::complex<Real>* data, std::vector<std::complex<Real>>& scratch, bool inverse) const {
+    for (int y = 0; y < n; y++)
+        transform(data + (size_t)y * n, 1, inverse);
+
+    // the columns are copied into a contiguous line, the strided butterflies would miss the cache
+    scratch.resize(n);
+    for (int x = 0; x < n; x++) {
+        for (int y = 0; y < n; y++)
+            scratch[y] = data[(size_t)y * n + x];
+        transform(scratch.data(), 1, inverse);
+        for (int y = 0; y < n; y++)
+            data[(size_t)y * n + x] = scratch[y];
+    }
+}
+
+template class FftPlan<float>;
+template class FftPlan<double>;
@@ -0,0 +1,35 @@
+#ifndef GAUSSIAN_BLUR_FFT_H
+#define GAUSSIAN_BLUR_FFT_H
+
+#include <complex>
+#include <vector>
+
+// the product without the checks for infinite and nan operands of std::complex, which are not inlined
+template <typename Real>
+inline std::complex<Real> complexMultiply(const std::complex<Real>& a, const std::complex<Real>& b) {
+    return std::complex<Real>(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+// An in-place radix-2 fast fourier transform of one power of two size. The twiddle factors
+// and the bit reversed order are computed once, so a plan can transform many lines and tiles.
+// The inverse is not normalized, a forward and an inverse transform scale by size per axis.
+template <typename Real>
+class FftPlan {
+public:
+    explicit FftPlan(int size);
+
+    int size() const { return n; }
+
+    // transforms the size values data[0], data[stride], ... of one line
+    void transform(std::complex<Real>* data, size_t stride, bool inverse) const;
+
+    // transforms the rows and then the columns of a size x size tile, scratch holds one column
+    void transform2d(std::complex<Real>* data, std::vector<std::complex<Real>>& scratch, bool inverse) const;
+
+private:
+    int n;
+    std::vector<int> reversed;
+    std::vector<std::complex<Real>> twiddles;
+};
+
+#endif //GAUSSIAN_BLUR_FFT_H
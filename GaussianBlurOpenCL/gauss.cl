@@ -1,53 +1,679 @@
-__kernel void test(
-	__global uchar* r,
-	__global uchar* g,
-	__global uchar* b,
-	__global uchar* rOut,
-	__global uchar* gOut,
-	__global uchar* bOut,
-	__global const int* kernelSize,
-	__global const double* blurKernel,
-	__local uchar* tempR,
-	__local uchar* tempG,
-	__local uchar* tempB
+// Both passes work on 2D tiles: every work-group loads its tile plus a halo of
+// kernelSize / 2 pixels on each side into local memory, so the image size is
+// independent of the work-group size. Pixels outside the image are clamped to the edge.
+// Every work-item blurs pixelsPerItem pixels along the pass direction, which makes the
+// tile longer than the work-group and keeps the halo overhead low for large kernels.
+
+// the arithmetic precision is chosen at build time, float is the default because double
+// runs at a fraction of the float rate on most GPUs and needs cl_khr_fp64. The results are
+// stored with a saturating conversion since half sums can round up past 255.
+#if defined(USE_DOUBLE)
+#pragma OPENCL EXTENSION cl_khr_fp64 : enable
+typedef double real;
+typedef double4 real4;
+#define convert_real4 convert_double4
+#elif defined(USE_HALF)
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+typedef half real;
+typedef half4 real4;
+#define convert_real4 convert_half4
+#else
+typedef float real;
+typedef float4 real4;
+#define convert_real4 convert_float4
+#endif
+
+// Fixed point programs blur with 16 bit integer weights that sum up to 1 << FIXED_BITS and add
+// the products up in 32 bit integers, at most 255 << FIXED_BITS. The other kernels of these
+// programs compute in float.
+#if defined(USE_FIXED)
+typedef short weight;
+typedef int4 pass4;
+#define convert_pass4 convert_int4
+#else
+typedef real weight;
+typedef real4 pass4;
+#define convert_pass4 convert_real4
+#endif
+
+// the weights are read by all work-items in lockstep, so constant memory is the fastest
+// place for them. Kernels that do not fit into the constant buffer are built with __global.
+#ifndef WEIGHT_SPACE
+#define WEIGHT_SPACE __constant
+#endif
+
+// Specialized programs are built with KSIZE and BLUR_WEIGHTS defined, BLUR_WEIGHTS lists the
+// center weight followed by the weights of increasing distance. The tap loops then have a
+// compile-time trip count and constant weights, so the compiler can fully unroll them.
+// Without KSIZE the kernel size and the weights are read from the kernel arguments.
+#ifdef KSIZE
+__constant weight specializedWeights[KSIZE / 2 + 1] = { BLUR_WEIGHTS };
+#define KERNEL_SIZE KSIZE
+#define WEIGHT(i) specializedWeights[(i)]
+#else
+#define KERNEL_SIZE kernelSize
+#define WEIGHT(i) blurKernel[radius + (i)]
+#endif
+
+// the image is blurred in the interleaved layout of the tga data, RGB or RGBA. All channels
+// of a pixel are loaded and blurred together as one vector, RGB pixels are padded to four
+// channels in local memory so the tiles stay aligned.
+#ifndef CHANNELS
+#define CHANNELS 3
+#endif
+
+#if CHANNELS == 4
+#define load_pixel(index, data) vload4((index), (data))
+#define store_pixel(pixel, index, data) vstore4((pixel), (index), (data))
+#else
+#define load_pixel(index, data) (uchar4)(vload3((index), (data)), 0)
+#define store_pixel(pixel, index, data) vstore3((pixel).xyz, (index), (data))
+#endif
+
+// RGBA images are blurred with premultiplied alpha so that the color of transparent pixels
+// does not bleed into their neighbours. The horizontal pass premultiplies while loading the
+// source image and the vertical pass divides the alpha back out before rounding.
+#ifdef PREMULTIPLY_ALPHA
+uchar4 premultiply(uchar4 pixel)
+{
+  // exact rounded c * a / 255 in integer arithmetic
+  uint3 product = convert_uint3(pixel.xyz) * (uint)pixel.w + 128;
+  pixel.xyz = convert_uchar3((product + (product >> 8)) >> 8);
+  return pixel;
+}
+
+real4 unpremultiply(real4 pixel)
+{
+  // pixels that end up fully transparent keep black as their color
+  real scale = pixel.w >= (real)0.5 ? (real)255 / pixel.w : (real)0;
+  return (real4)(pixel.xyz * scale, pixel.w);
+}
+
+#define load_source_pixel(index, data) premultiply(load_pixel((index), (data)))
+#define finish_pixel(pixel) unpremultiply(pixel)
+#else
+#define load_source_pixel(index, data) load_pixel((index), (data))
+#define finish_pixel(pixel) (pixel)
+#endif
+
+// round_pass rounds the sums of a pass to 8 bits, finish_pass also unpremultiplies RGBA
+#if defined(USE_FIXED)
+uchar4 round_pass(int4 blur)
+{
+  // half up, the sums are never negative
+  return convert_uchar4_sat((blur + (1 << (FIXED_BITS - 1))) >> FIXED_BITS);
+}
+
+#ifdef PREMULTIPLY_ALPHA
+uchar4 finish_pass(int4 blur)
+{
+  // color * 255 / alpha rounded half up in integers, below half an alpha level the color is black.
+  // color * 510 reaches 2^31, so the division runs on unsigned values
+  uint4 sums = convert_uint4(blur);
+  uchar4 pixel = round_pass(blur);
+  if (sums.w >= (1u << (FIXED_BITS - 1)))
+    pixel.xyz = convert_uchar3_sat((sums.xyz * 510u + sums.w) / (2u * sums.w));
+  else
+    pixel.xyz = 0;
+  return pixel;
+}
+#else
+#define finish_pass(blur) round_pass(blur)
+#endif
+#else
+#define round_pass(blur) convert_uchar4_sat(round(blur))
+#define finish_pass(blur) convert_uchar4_sat(round(finish_pixel(blur)))
+#endif
+
+// Blurs the rows of the image. The horizontal pass reads the source image, the second row pass
+// of the transposed mode reads the transposed result of the first one and finishes the pixels.
+void blur_rows(
+	__global const uchar* image,
+	__global uchar* imageOut,
+	const int width,
+	const int height,
+	const int kernelSize,
+	const int pixelsPerItem,
+	WEIGHT_SPACE const weight* blurKernel,
+	__local uchar4* tile,
+	const int sourcePass
 	)
 {
   // for accessing the correct pixel
-  size_t px = get_global_id(0);
-  size_t py = get_global_id(1);
-  size_t width = get_global_size(0);
-  size_t globalIndex = py * width + px;
+  int py = get_global_id(1);
+  int lx = get_local_id(0);
+  int ly = get_local_id(1);
+  int groupWidth = get_local_size(0);
+  int tileWidth = groupWidth * pixelsPerItem;
+  int tileX = get_group_id(0) * tileWidth;
 
-  // for storing it at the right place
-  size_t localIndex = get_local_id(0) + get_local_id(1);
+  int radius = KERNEL_SIZE / 2;
+  int rowLength = tileWidth + 2 * radius;
+  int rowStart = ly * rowLength;
 
-  // for knowing the length of the local arrays
-  size_t size = get_local_size(0) * get_local_size(1);
+  // the global size is rounded up to the work-group size, so rows past the end read the last row
+  int y = min(py, height - 1);
 
-  tempR[localIndex] = r[globalIndex];
-  tempG[localIndex] = g[globalIndex];
-  tempB[localIndex] = b[globalIndex];
+  // load the tile row together with its left and right halo
+  for (int i = lx; i < rowLength; i += groupWidth) {
+    int x = clamp(tileX - radius + i, 0, width - 1);
+    tile[rowStart + i] = sourcePass ? load_source_pixel(y * width + x, image) : load_pixel(y * width + x, image);
+  }
 
   // waiting for the local arrays to be fully initialzed accross the workgroup
   barrier(CLK_LOCAL_MEM_FENCE);
 
-  int kSize = *kernelSize;
+  if (py >= height)
+    return;
+
+  // the pixels of one work-item are groupWidth apart so that the stores stay coalesced
+  for (int p = 0; p < pixelsPerItem; p++) {
+    int tx = lx + p * groupWidth;
+    int px = tileX + tx;
+    if (px >= width)
+      break;
+
+    int center = rowStart + tx + radius;
+    pass4 blur = convert_pass4(tile[center]) * WEIGHT(0);
+
+    // the kernel is symmetric, so both taps at the same distance share one multiplication
+#ifdef KSIZE
+    #pragma unroll
+#endif
+    for (int i = 1; i <= radius; i++) {
+      ushort4 taps = convert_ushort4(tile[center - i]) + convert_ushort4(tile[center + i]);
+      blur += convert_pass4(taps) * WEIGHT(i);
+    }
+
+    store_pixel(sourcePass ? round_pass(blur) : finish_pass(blur), py * width + px, imageOut);
+  }
+}
+
+__kernel void blur_horizontal(
+	__global const uchar* image,
+	__global uchar* imageOut,
+	const int width,
+	const int height,
+	const int kernelSize,
+	const int pixelsPerItem,
+	WEIGHT_SPACE const weight* blurKernel,
+	__local uchar4* tile
+	)
+{
+  blur_rows(image, imageOut, width, height, kernelSize, pixelsPerItem, blurKernel, tile, 1);
+}
+
+// the vertical pass of the transposed mode, a row pass over the transposed image
+__kernel void blur_transposed(
+	__global const uchar* image,
+	__global uchar* imageOut,
+	const int width,
+	const int height,
+	const int kernelSize,
+	const int pixelsPerItem,
+	WEIGHT_SPACE const weight* blurKernel,
+	__local uchar4* tile
+	)
+{
+  blur_rows(image, imageOut, width, height, kernelSize, pixelsPerItem, blurKernel, tile, 0);
+}
+
+// Transposes the image through a square tile in local memory, so both the reads and the writes
+// of neighbouring work-items go to neighbouring pixels. The output is height pixels wide. The tile
+// rows have one pixel of padding so the transposed reads of a work-group hit different banks.
+__kernel void transpose(
+	__global const uchar* image,
+	__global uchar* imageOut,
+	const int width,
+	const int height,
+	__local uchar4* tile
+	)
+{
+  int lx = get_local_id(0);
+  int ly = get_local_id(1);
+  int tileSize = get_local_size(0);
+  int tileStride = tileSize + 1;
+  int x = get_global_id(0);
+  int y = get_global_id(1);
+
+  if (x < width && y < height)
+    tile[ly * tileStride + lx] = load_pixel(y * width + x, image);
+
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  int outX = get_group_id(1) * tileSize + lx;
+  int outY = get_group_id(0) * tileSize + ly;
+  if (outX < height && outY < width)
+    store_pixel(tile[lx * tileStride + ly], outY * height + outX, imageOut);
+}
+
+__kernel void blur_vertical(
+	__global const uchar* image,
+	__global uchar* imageOut,
+	const int width,
+	const int height,
+	const int kernelSize,
+	const int pixelsPerItem,
+	WEIGHT_SPACE const weight* blurKernel,
+	__local uchar4* tile
+	)
+{
+  // for accessing the correct pixel
+  int px = get_global_id(0);
+  int lx = get_local_id(0);
+  int ly = get_local_id(1);
+  int tileWidth = get_local_size(0);
+  int groupHeight = get_local_size(1);
+  int tileHeight = groupHeight * pixelsPerItem;
+  int tileY = get_group_id(1) * tileHeight;
+
+  int radius = KERNEL_SIZE / 2;
+  int columnLength = tileHeight + 2 * radius;
+
+  // the global size is rounded up to the work-group size, so columns past the end read the last column
+  int x = min(px, width - 1);
+
+  // load the tile columns together with their upper and lower halo, neighbouring
+  // work-items read neighbouring pixels so the loads stay coalesced
+  for (int i = ly; i < columnLength; i += groupHeight) {
+    int y = clamp(tileY - radius + i, 0, height - 1);
+    tile[i * tileWidth + lx] = load_pixel(y * width + x, image);
+  }
+
+  // waiting for the local arrays to be fully initialzed accross the workgroup
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  if (px >= width)
+    return;
+
+  for (int p = 0; p < pixelsPerItem; p++) {
+    int ty = ly + p * groupHeight;
+    int py = tileY + ty;
+    if (py >= height)
+      break;
+
+    int center = (ty + radius) * tileWidth + lx;
+    pass4 blur = convert_pass4(tile[center]) * WEIGHT(0);
+
+    // the kernel is symmetric, so both taps at the same distance share one multiplication
+#ifdef KSIZE
+    #pragma unroll
+#endif
+    for (int i = 1; i <= radius; i++) {
+      int offset = i * tileWidth;
+      ushort4 taps = convert_ushort4(tile[center - offset]) + convert_ushort4(tile[center + offset]);
+      blur += convert_pass4(taps) * WEIGHT(i);
+    }
+
+    store_pixel(finish_pass(blur), py * width + px, imageOut);
+  }
+}
+
+// Specialized programs only run the separable passes and the transpose, the line filters and
+// the convolutions are left out of them so the compile per kernel size and sigma stays short.
+#ifndef KSIZE
+
+// The box3 and iir methods: every work-item filters one column of the image, so neighbouring
+// work-items load and store neighbouring pixels. The host filters the rows as the columns of
+// the transposed image and transposes the result back. A column is filtered in place in a
+// plane of lines in the layout of the image. The values are float even for half precision,
+// whose 11 bit mantissa can not hold them.
+#if defined(USE_DOUBLE)
+typedef double accum;
+typedef double4 accum4;
+#define convert_accum4 convert_double4
+#else
+typedef float accum;
+typedef float4 accum4;
+#define convert_accum4 convert_float4
+#endif
+
+// like the separable passes the first pass premultiplies and the second finishes the pixels
+void load_line(
+	__global const uchar* image,
+	__global accum4* line,
+	const int column,
+	const int width,
+	const int length,
+	const int sourcePass
+	)
+{
+  for (int i = 0; i < length; i++) {
+    int index = column + i * width;
+    line[index] = convert_accum4(sourcePass ? load_source_pixel(index, image) : load_pixel(index, image));
+  }
+}
+
+void store_line(
+	__global const accum4* line,
+	__global uchar* imageOut,
+	const int column,
+	const int width,
+	const int length,
+	const int sourcePass
+	)
+{
+  for (int i = 0; i < length; i++) {
+    int index = column + i * width;
+    real4 blur = convert_real4(line[index]);
+    if (!sourcePass)
+      blur = finish_pixel(blur);
+    store_pixel(convert_uchar4_sat(round(blur)), index, imageOut);
+  }
+}
+
+// The running sum adds the pixel entering the window and drops the one leaving it, so the
+// cost per pixel does not depend on the radius. The pixel leaving the window has been
+// overwritten radius pixels before, so the last radius + 1 pixels of the column are kept in
+// the ring, slot s of the column at s * width + column.
+void box_line(
+	__global accum4* line,
+	__global accum4* ring,
+	const int column,
+	const int width,
+	const int length,
+	const int radius
+	)
+{
+  accum scale = (accum)1 / (accum)(2 * radius + 1);
+  int slots = min(radius + 1, length);
+  accum4 first = line[column];
+  accum4 last = line[column + (length - 1) * width];
 
-  double rBlur = 0.0;
-  double gBlur = 0.0;
-  double bBlur = 0.0;
+  // the window of the first pixel, clamped to the edge
+  accum4 sum = 0;
+  for (int i = -radius; i <= radius; i++)
+    sum += line[column + clamp(i, 0, length - 1) * width];
 
-  for (int i = 0; i < kSize; i++) {
-    int x = localIndex - (kSize / 2) + i;
-    if (x < 0) x = 0;
-    if (x >= size) x = size - 1;
+  for (int i = 0; i < length; i++) {
+    int index = column + i * width;
+    ring[(i % slots) * width + column] = line[index];
 
-    rBlur += (double)tempR[x] * blurKernel[i];
-    gBlur += (double)tempG[x] * blurKernel[i];
-    bBlur += (double)tempB[x] * blurKernel[i];
+    int leaving = i - radius;
+    int entering = i + radius + 1;
+    accum4 leavingPixel = leaving > 0 ? ring[(leaving % slots) * width + column] : first;
+    accum4 enteringPixel = entering < length ? line[column + entering * width] : last;
+    line[index] = sum * scale;
+    sum += enteringPixel - leavingPixel;
   }
+}
+
+__kernel void box_blur(
+	__global const uchar* image,
+	__global uchar* imageOut,
+	__global accum4* lines,
+	__global accum4* ring,
+	const int width,
+	const int height,
+	const int sourcePass,
+	const int radius0,
+	const int radius1,
+	const int radius2
+	)
+{
+  int column = get_global_id(0);
+  if (column >= width)
+    return;
+
+  load_line(image, lines, column, width, height, sourcePass);
+  box_line(lines, ring, column, width, height, radius0);
+  box_line(lines, ring, column, width, height, radius1);
+  box_line(lines, ring, column, width, height, radius2);
+  store_line(lines, imageOut, column, width, height, sourcePass);
+}
+
+// The recursive gaussian of Young and van Vliet, coefficients holds B, a1, a2 and a3. The causal
+// pass starts in the steady state of the first pixel, the anticausal pass starts three pixels
+// past the end at the last pixel plus the rows of the boundary matrix times the deviations of
+// the last three causal outputs from it. Both passes run in place. The poles approach one as
+// sigma grows, so the host builds this kernel in double wherever the device supports it.
+__kernel void iir_blur(
+	__global const uchar* image,
+	__global uchar* imageOut,
+	__global accum4* lines,
+	const int width,
+	const int height,
+	const int sourcePass,
+	const accum4 coefficients,
+	const accum4 boundary0,
+	const accum4 boundary1,
+	const accum4 boundary2
+	)
+{
+  int column = get_global_id(0);
+  if (column >= width)
+    return;
+
+  accum scale = coefficients.x;
+  accum a1 = coefficients.y;
+  accum a2 = coefficients.z;
+  accum a3 = coefficients.w;
+
+  load_line(image, lines, column, width, height, sourcePass);
+
+  accum4 first = lines[column];
+  accum4 last = lines[column + (height - 1) * width];
+  accum4 w1 = first, w2 = first, w3 = first;
+  for (int i = 0; i < height; i++) {
+    int index = column + i * width;
+    accum4 w = scale * lines[index] + a1 * w1 + a2 * w2 + a3 * w3;
+    lines[index] = w;
+    w3 = w2;
+    w2 = w1;
+    w1 = w;
+  }
+
+  // w1, w2 and w3 are the last three causal outputs, or the first pixel on short lines
+  accum4 y1 = last + boundary0.x * (w1 - last) + boundary0.y * (w2 - last) + boundary0.z * (w3 - last);
+  accum4 y2 = last + boundary1.x * (w1 - last) + boundary1.y * (w2 - last) + boundary1.z * (w3 - last);
+  accum4 y3 = last + boundary2.x * (w1 - last) + boundary2.y * (w2 - last) + boundary2.z * (w3 - last);
+  for (int i = height - 1; i >= 0; i--) {
+    int index = column + i * width;
+    accum4 y = scale * lines[index] + a1 * y1 + a2 * y2 + a3 * y3;
+    lines[index] = y;
+    y3 = y2;
+    y2 = y1;
+    y1 = y;
+  }
+
+  store_line(lines, imageOut, column, width, height, sourcePass);
+}
+
+// The 2D convolution with an arbitrary kernel, centered at (kernelWidth / 2, kernelHeight / 2).
+// The direct kernel sums all taps of a pixel with clamped loads, the fft path convolves tiles
+// of the padded image through their spectra and adds the overlapping results up.
+#if defined(USE_DOUBLE)
+typedef double2 accum2;
+#define ACCUM_PI M_PI
+#else
+typedef float2 accum2;
+#define ACCUM_PI M_PI_F
+#endif
+
+__kernel void convolve_direct(
+	__global const uchar* image,
+	__global uchar* imageOut,
+	__global const accum* weights,
+	const int width,
+	const int height,
+	const int kernelWidth,
+	const int kernelHeight
+	)
+{
+  int px = get_global_id(0);
+  int py = get_global_id(1);
+  if (px >= width || py >= height)
+    return;
+
+  int cx = kernelWidth / 2;
+  int cy = kernelHeight / 2;
+  accum4 sum = 0;
+  for (int j = 0; j < kernelHeight; j++) {
+    int y = clamp(py + cy - j, 0, height - 1);
+    for (int i = 0; i < kernelWidth; i++) {
+      int x = clamp(px + cx - i, 0, width - 1);
+      sum += weights[j * kernelWidth + i] * convert_accum4(load_source_pixel(y * width + x, image));
+    }
+  }
+
+  store_pixel(convert_uchar4_sat(round(finish_pixel(convert_real4(sum)))), py * width + px, imageOut);
+}
+
+accum2 complex_multiply(accum2 a, accum2 b)
+{
+  return (accum2)(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+// Loads the tiles of tileRows rows of tiles starting at firstTileRow into fftSize square
+// complex tiles, one channel in the real and one in the imaginary part. The padded image is the
+// image extended by the kernel size minus one, edge pixels repeated, so the kernel is complete
+// over every pixel of the image. Past tileSize and past the padded image the tiles are zero.
+__kernel void fft_load_tiles(
+	__global const uchar* image,
+	__global accum2* tiles,
+	const int width,
+	const int height,
+	const int kernelWidth,
+	const int kernelHeight,
+	const int fftSize,
+	const int tileSize,
+	const int tilesX,
+	const int firstTileRow,
+	const int upperPair
+	)
+{
+  int i = get_global_id(0);
+  int j = get_global_id(1);
+  int tile = get_global_id(2);
+  int u = (tile % tilesX) * tileSize + i;
+  int v = (firstTileRow + tile / tilesX) * tileSize + j;
+
+  accum2 value = 0;
+  if (i < tileSize && j < tileSize && u < width + kernelWidth - 1 && v < height + kernelHeight - 1) {
+    int x = clamp(u - (kernelWidth - 1 - kernelWidth / 2), 0, width - 1);
+    int y = clamp(v - (kernelHeight - 1 - kernelHeight / 2), 0, height - 1);
+    accum4 pixel = convert_accum4(load_source_pixel(y * width + x, image));
+    value = upperPair ? pixel.zw : pixel.xy;
+  }
+  tiles[(tile * fftSize + j) * fftSize + i] = value;
+}
+
+// Radix-2 transform in place of one row (alongAxis 0) or column (alongAxis 1) of a tile per
+// work-item, neighbouring work-items of the column transform read neighbouring values.
+// The inverse is not normalized, the host scales the spectrum of the kernel instead.
+__kernel void fft_lines(
+	__global accum2* tiles,
+	const int fftSize,
+	const int logSize,
+	const int alongAxis,
+	const int inverse
+	)
+{
+  int line = get_global_id(0);
+  __global accum2* data = tiles + get_global_id(1) * fftSize * fftSize;
+  int start = alongAxis ? line : line * fftSize;
+  int step = alongAxis ? fftSize : 1;
+
+  for (int i = 0; i < fftSize; i++) {
+    int reversed = 0;
+    for (int b = 0; b < logSize; b++)
+      reversed |= ((i >> b) & 1) << (logSize - 1 - b);
+    if (reversed > i) {
+      accum2 swap = data[start + i * step];
+      data[start + i * step] = data[start + reversed * step];
+      data[start + reversed * step] = swap;
+    }
+  }
+
+  for (int length = 2; length <= fftSize; length <<= 1) {
+    int half = length / 2;
+    accum angle = (inverse ? (accum)2 : (accum)-2) * ACCUM_PI / length;
+    for (int k = 0; k < half; k++) {
+      accum c;
+      accum s = sincos(angle * k, &c);
+      accum2 twiddle = (accum2)(c, s);
+      for (int first = start + k * step; first < start + fftSize * step; first += length * step) {
+        int second = first + half * step;
+        accum2 product = complex_multiply(data[second], twiddle);
+        data[second] = data[first] - product;
+        data[first] += product;
+      }
+    }
+  }
+}
+
+__kernel void fft_multiply(
+	__global accum2* tiles,
+	__global const accum2* spectrum,
+	const int area
+	)
+{
+  int k = get_global_id(0);
+  int index = get_global_id(1) * area + k;
+  tiles[index] = complex_multiply(tiles[index], spectrum[k]);
+}
+
+// Adds up the parts of the convolved tiles that fall on every pixel of the image, at most two
+// tiles per direction since the tiles are at least as large as the kernel. The tiles of one
+// group of tile rows are added at a time, clear starts the channel pair over with the first group.
+__kernel void fft_accumulate(
+	__global const accum2* tiles,
+	__global accum4* result,
+	const int width,
+	const int height,
+	const int kernelWidth,
+	const int kernelHeight,
+	const int fftSize,
+	const int tileSize,
+	const int tilesX,
+	const int firstTileRow,
+	const int tileRows,
+	const int upperPair,
+	const int clear
+	)
+{
+  int px = get_global_id(0);
+  int py = get_global_id(1);
+  if (px >= width || py >= height)
+    return;
+
+  // the pixel in the padded image and the tiles whose results reach it
+  int u = px + kernelWidth - 1;
+  int v = py + kernelHeight - 1;
+  int firstX = max((u - fftSize + tileSize) / tileSize, 0);
+  int lastX = min(u / tileSize, tilesX - 1);
+  int firstY = max((v - fftSize + tileSize) / tileSize, firstTileRow);
+  int lastY = min(v / tileSize, firstTileRow + tileRows - 1);
+
+  accum2 sum = 0;
+  for (int ty = firstY; ty <= lastY; ty++) {
+    for (int tx = firstX; tx <= lastX; tx++) {
+      int tile = (ty - firstTileRow) * tilesX + tx;
+      sum += tiles[(tile * fftSize + v - ty * tileSize) * fftSize + u - tx * tileSize];
+    }
+  }
+
+  int index = py * width + px;
+  accum4 value = clear && !upperPair ? (accum4)0 : result[index];
+  if (upperPair)
+    value.zw = (clear ? (accum2)0 : value.zw) + sum;
+  else
+    value.xy += sum;
+  result[index] = value;
+}
+
+__kernel void convolve_store(
+	__global const accum4* result,
+	__global uchar* imageOut,
+	const int width,
+	const int height
+	)
+{
+  int index = get_global_id(0);
+  if (index >= width * height)
+    return;
+
+  store_pixel(convert_uchar4_sat(round(finish_pixel(convert_real4(result[index])))), index, imageOut);
+}
 
-  rOut[globalIndex] = (unsigned char)round(rBlur);
-  gOut[globalIndex] = (unsigned char)round(gBlur);
-  bOut[globalIndex] = (unsigned char)round(bBlur);
-}
\ No newline at end of file
+#endif // KSIZE
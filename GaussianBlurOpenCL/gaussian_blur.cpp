@@ -1,7 +1,11 @@
 #include <iostream>
+#include <algorithm>
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 double _2d_gaussian_function(int x, int y, double std_dev) {
     double std_dev_2 = 2 * std_dev * std_dev;
@@ -55,6 +59,98 @@ double* _1d_blur_kernel(int kernel_size, double std_dev) {
     return kernel;
 }
 
+float* _1d_blur_kernel_float(int kernel_size, double std_dev) {
+    double* blur = _1d_blur_kernel(kernel_size, std_dev);
+
+    float* kernel = new float[kernel_size];
+    for (int i = 0; i < kernel_size; ++i)
+        kernel[i] = (float)blur[i];
+
+    delete[] blur;
+
+    return kernel;
+}
+
+// converts a float to a half with round to nearest even, the weights are always finite and positive
+unsigned short _float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent >= 31)
+        return (unsigned short)(sign | 0x7c00);
+
+    // too small for a normal half, store it as a subnormal or zero
+    int shift = 13;
+    uint32_t half;
+    if (exponent <= 0) {
+        if (exponent < -10)
+            return (unsigned short)sign;
+        mantissa |= 0x800000;
+        shift = 14 - exponent;
+        half = mantissa >> shift;
+    } else {
+        half = ((uint32_t)exponent << 10) | (mantissa >> shift);
+    }
+
+    // a carry out of the mantissa correctly moves on to the next exponent
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1)))
+        half++;
+
+    return (unsigned short)(sign | half);
+}
+
+unsigned short* _1d_blur_kernel_half(int kernel_size, double std_dev) {
+    double* blur = _1d_blur_kernel(kernel_size, std_dev);
+
+    unsigned short* kernel = new unsigned short[kernel_size];
+    for (int i = 0; i < kernel_size; ++i)
+        kernel[i] = _float_to_half((float)blur[i]);
+
+    delete[] blur;
+
+    return kernel;
+}
+
+short* _1d_blur_kernel_fixed(int kernel_size, double std_dev, int bits) {
+    double* blur = _1d_blur_kernel(kernel_size, std_dev);
+    int k = kernel_size / 2;
+    int one = 1 << bits;
+
+    // round every weight down, the rest of the sum goes to the weights that lost the most.
+    // The sides get their units in pairs to keep the kernel symmetric, an odd unit goes to the center
+    std::vector<int> weights(k + 1);
+    std::vector<std::pair<double, int>> remainders;
+    int missing = one;
+    for (int i = 0; i <= k; ++i) {
+        double scaled = blur[k + i] * one;
+        weights[i] = (int)floor(scaled);
+        missing -= i == 0 ? weights[i] : 2 * weights[i];
+        if (i > 0)
+            remainders.push_back(std::make_pair(scaled - weights[i], i));
+    }
+    delete[] blur;
+
+    if (missing % 2 == 1) {
+        weights[0]++;
+        missing--;
+    }
+    std::stable_sort(remainders.begin(), remainders.end(), [](const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.first > b.first; });
+    for (int i = 0; missing > 0; ++i, missing -= 2)
+        weights[remainders[i].second]++;
+
+    short* kernel = new short[kernel_size];
+    for (int i = 0; i < kernel_size; ++i)
+        kernel[i] = (short)weights[abs(i - k)];
+
+    return kernel;
+}
+
 double* _2d_blur_kernel(int kernel_size, double std_dev) {
     double** kernel = new double* [kernel_size];
     for (int i = 0; i < kernel_size; i++)
@@ -107,3 +203,75 @@ double* _2d_blur_kernel(int kernel_size, double std_dev) {
     return simpleKernel;
 }
 
+
+void _box_blur_radii(double std_dev, int boxes, int* radii) {
+    // a box of odd width w has the variance (w * w - 1) / 12 and the variances of successive
+    // blurs add up, so boxes of the ideal width sqrt(12 * variance / boxes + 1) match the gaussian.
+    // The widths have to be odd, m boxes get the odd width below the ideal one and the others
+    // the odd width above, with m chosen so that the total variance comes closest to std_dev^2
+    double variance = std_dev * std_dev;
+    double ideal = sqrt(12.0 * variance / boxes + 1.0);
+    int lower = (int)floor(ideal);
+    if (lower % 2 == 0)
+        lower--;
+    if (lower < 1)
+        lower = 1;
+    int upper = lower + 2;
+
+    double m = (12.0 * variance - boxes * lower * lower - 4.0 * boxes * lower - 3.0 * boxes) / (-4.0 * lower - 4.0);
+    int smaller = (int)lround(m);
+    if (smaller < 0)
+        smaller = 0;
+    if (smaller > boxes)
+        smaller = boxes;
+
+    for (int i = 0; i < boxes; ++i)
+        radii[i] = ((i < smaller ? lower : upper) - 1) / 2;
+}
+
+void _iir_blur_coefficients(double std_dev, double coefficients[4], double boundary[9]) {
+    // Young and van Vliet, "Recursive implementation of the Gaussian filter", 1995. The
+    // fit of q to sigma is only valid from 0.5 on
+    double sigma = std_dev < 0.5 ? 0.5 : std_dev;
+    double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma);
+    double q2 = q * q;
+    double q3 = q2 * q;
+
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double a1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+    double a2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+    double a3 = 0.422205 * q3 / b0;
+
+    // the gain at zero frequency is one for both passes
+    coefficients[0] = 1.0 - (a1 + a2 + a3);
+    coefficients[1] = a1;
+    coefficients[2] = a2;
+    coefficients[3] = a3;
+
+    // Past the right edge the clamped image continues with its last pixel u, so the causal
+    // pass keeps running on its last three outputs and the anticausal pass starts from the
+    // far end of that continuation, as in Triggs and Sdika, "Boundary conditions for
+    // Young-van Vliet recursive filtering", 2006. Both passes are linear in the deviations
+    // from u, so the first three anticausal outputs past the edge are u plus the boundary
+    // matrix times the deviations of the last three causal outputs. Its columns are found
+    // by running both passes on unit deviations until the response has decayed.
+    int length = (int)ceil(40.0 * q) + 16;
+    std::vector<double> causal(length + 3), anticausal(length + 3);
+    for (int j = 0; j < 3; ++j) {
+        // causal[2 - j] is the deviation of the output j pixels before the edge
+        for (int n = 0; n < length + 3; ++n)
+            causal[n] = n == 2 - j ? 1.0 : 0.0;
+        for (int n = 3; n < length + 3; ++n)
+            causal[n] = a1 * causal[n - 1] + a2 * causal[n - 2] + a3 * causal[n - 3];
+
+        for (int n = length + 2; n >= 3; --n) {
+            double next1 = n + 1 < length + 3 ? anticausal[n + 1] : 0.0;
+            double next2 = n + 2 < length + 3 ? anticausal[n + 2] : 0.0;
+            double next3 = n + 3 < length + 3 ? anticausal[n + 3] : 0.0;
+            anticausal[n] = coefficients[0] * causal[n] + a1 * next1 + a2 * next2 + a3 * next3;
+        }
+
+        for (int k = 0; k < 3; ++k)
+            boundary[k * 3 + j] = anticausal[3 + k];
+    }
+}
@@ -8,4 +8,20 @@
 double* _1d_blur_kernel(int kernel_size, double std_dev);
 double* _2d_blur_kernel(int kernel_size, double std_dev);
 
+// _1d_blur_kernel converted to single precision and to IEEE 754 half precision bit patterns
+float* _1d_blur_kernel_float(int kernel_size, double std_dev);
+unsigned short* _1d_blur_kernel_half(int kernel_size, double std_dev);
+
+// _1d_blur_kernel quantized to integers that sum up to exactly 1 << bits and stay symmetric
+short* _1d_blur_kernel_fixed(int kernel_size, double std_dev, int bits);
+
+// the radii of the boxes whose successive blurs approximate a gaussian of std_dev, ascending
+void _box_blur_radii(double std_dev, int boxes, int* radii);
+
+// The recursive gaussian of Young and van Vliet: coefficients holds B, a1, a2 and a3 of
+// w[n] = B x[n] + a1 w[n - 1] + a2 w[n - 2] + a3 w[n - 3] and of the same filter running backwards.
+// Row k of the 3x3 boundary matrix gives the backward output k pixels past the right edge
+// from the deviations of the last three forward outputs from the last input, the last first.
+void _iir_blur_coefficients(double std_dev, double coefficients[4], double boundary[9]);
+
 #endif //GAUSSIAN_BLUR_GAUSSIAN_BLUR_H
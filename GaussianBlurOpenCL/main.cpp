@@ -1,23 +1,52 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include "cxxopts.hpp"
 #include "gaussian_blur.h"
 #include "tga.h"
-#include <memory>
-#define CL_MINIMUM_OPENCL_VERSION 120
-#define CL_TARGET_OPENCL_VERSION 120
-#include "CL/cl.h"
-
-std::string cl_errorstring(cl_int err);
-void checkStatus(cl_int err);
-void printCompilerError(cl_program program, cl_device_id device);
+#include "blur_engine.h"
+#include "device_scheduler.h"
+#include "device_info.h"
+#include "batch.h"
+#include "convolution.h"
+#include "streaming.h"
+#include "tga_mapped.h"
+#include "temporary_file.h"
 
 struct BlurOptions {
     std::string inFilePath;
     std::string outFilePath;
     int kernelSize;
     double sigma;
+    Precision precision;
+    std::string cacheDir;
+    std::string kernelSource;
+    HostMemory hostMemory;
+    std::string batchInput;
+    std::string outputDirectory;
+    int inFlightImages;
+    int readerThreads;
+    int writerThreads;
+    bool allDevices;
+    int platformIndex;
+    int deviceIndex;
+    std::string tuningFile;
+    bool autotune;
+    EngineType engineType;
+    int threads;
+    CpuIsa cpuIsa;
+    VerticalPass verticalPass;
+    BlurMethod method;
+    bool convolve2d;
+    std::string psfFile;
+    ConvolutionAlgorithm convolution;
+    bool stream;
+    bool mapFiles;
+    int stripRows;
 };
 
 int main(int argc, char** argv) {
@@ -27,21 +56,175 @@ int main(int argc, char** argv) {
         ("i,inFilePath", "Path to the image file to blur", cxxopts::value<std::string>())
         ("o,outFilePath", "Where the blurred image should be written to", cxxopts::value<std::string>())
         ("k,kernelSize", "Size of the kernel", cxxopts::value<int>())
-        ("s,sigma", "Sigma to use for the kernel calculation", cxxopts::value<double>());
+        ("s,sigma", "Sigma to use for the kernel calculation", cxxopts::value<double>())
+        ("method", "Blur method: exact uses the kernel size, box3 and iir approximate the sigma with three box blurs or a recursive filter in constant time per pixel, conv2d convolves with the 2D gaussian or the --psf kernel", cxxopts::value<std::string>()->default_value("exact"))
+        ("psf", "A tga image used as the kernel of conv2d, the weights are its brightness", cxxopts::value<std::string>()->default_value(""))
+        ("convolution", "How conv2d convolves: direct, fft or auto, which picks the cheaper one for the kernel size", cxxopts::value<std::string>()->default_value("auto"))
+        ("p,precision", "Arithmetic precision of the blur: double, float, half, fixed for 16 bit integer weights, or auto", cxxopts::value<std::string>()->default_value("float"))
+        ("cache-dir", "Directory in which built OpenCL programs are cached between runs", cxxopts::value<std::string>()->default_value(""))
+        ("kernel-source", "Load the OpenCL kernels from this file instead of the embedded gauss.cl", cxxopts::value<std::string>()->default_value(""))
+        ("zero-copy", "Use the image memory directly on the device: auto, on or off", cxxopts::value<std::string>()->default_value("auto"))
+        ("batch", "Blur many images: a directory, a wildcard like images/*.tga or a file listing one image per line", cxxopts::value<std::string>()->default_value(""))
+        ("stream", "Read, blur and write the image in horizontal strips, for images larger than the host or device memory")
+        ("strip-rows", "Rows of the image every strip of --stream writes, 0 picks them from the image width", cxxopts::value<int>()->default_value("0"))
+        ("mmap", "Map the input and output files into memory instead of reading and writing them, for uncompressed tga files")
+        ("output-dir", "Directory the blurred images of a batch are written to", cxxopts::value<std::string>()->default_value("blurred"))
+        ("in-flight", "Number of images a batch keeps on the device at the same time", cxxopts::value<int>()->default_value("2"))
+        ("readers", "Number of threads decoding images in a batch", cxxopts::value<int>()->default_value("2"))
+        ("writers", "Number of threads encoding images in a batch", cxxopts::value<int>()->default_value("2"))
+        ("all-devices", "Spread the work over every OpenCL device of every platform")
+        ("platform", "Index of the OpenCL platform to use", cxxopts::value<int>()->default_value("0"))
+        ("device", "Index of the device on the selected platform", cxxopts::value<int>()->default_value("0"))
+        ("list-devices", "Print the capabilities of all OpenCL devices and exit")
+        ("tuning-file", "Tuning database with the fastest launch configurations per device", cxxopts::value<std::string>()->default_value("gaussian_blur.tuning"))
+        ("engine", "Blur with opencl, the cpu or auto, which falls back to the cpu without OpenCL devices", cxxopts::value<std::string>()->default_value("auto"))
+        ("threads", "Number of threads of the cpu engine, 0 uses all hardware threads", cxxopts::value<int>()->default_value("0"))
+        ("cpu-isa", "Instruction set of the cpu engine: auto, scalar, sse4.1, avx2 or avx512", cxxopts::value<std::string>()->default_value("auto"))
+        ("vertical", "Vertical pass: direct strided access or transposed blocks", cxxopts::value<std::string>()->default_value("direct"))
+        ("autotune", "Benchmark the launch configurations for this image on every device and store the fastest ones in the tuning file");
 
     auto result = options.parse(argc, argv);
 
+    if (result.count("list-devices")) {
+        std::vector<DeviceInfo> devices = queryAllDevices();
+        if (devices.empty())
+            std::cout << "no OpenCL devices found" << std::endl;
+        for (const DeviceInfo& info : devices)
+            printDeviceInfo(info);
+        return 0;
+    }
+
     struct BlurOptions blurOptions;
-    blurOptions.inFilePath = result["inFilePath"].as<std::string>();
-    blurOptions.outFilePath = result["outFilePath"].as<std::string>();
+    if (result.count("inFilePath"))
+        blurOptions.inFilePath = result["inFilePath"].as<std::string>();
+    if (result.count("outFilePath"))
+        blurOptions.outFilePath = result["outFilePath"].as<std::string>();
+    blurOptions.batchInput = result["batch"].as<std::string>();
+    blurOptions.outputDirectory = result["output-dir"].as<std::string>();
+    blurOptions.inFlightImages = result["in-flight"].as<int>();
+    blurOptions.readerThreads = result["readers"].as<int>();
+    blurOptions.writerThreads = result["writers"].as<int>();
+    blurOptions.allDevices = result.count("all-devices") > 0;
+    blurOptions.platformIndex = result["platform"].as<int>();
+    blurOptions.deviceIndex = result["device"].as<int>();
+    blurOptions.tuningFile = result["tuning-file"].as<std::string>();
+    blurOptions.autotune = result.count("autotune") > 0;
+    blurOptions.threads = result["threads"].as<int>();
+    blurOptions.stream = result.count("stream") > 0;
+    blurOptions.mapFiles = result.count("mmap") > 0;
+    blurOptions.stripRows = result["strip-rows"].as<int>();
+
+    std::string cpuIsa = result["cpu-isa"].as<std::string>();
+    if (cpuIsa == "auto") {
+        blurOptions.cpuIsa = CpuIsa::Auto;
+    } else if (cpuIsa == "scalar") {
+        blurOptions.cpuIsa = CpuIsa::Scalar;
+    } else if (cpuIsa == "sse4.1") {
+        blurOptions.cpuIsa = CpuIsa::Sse41;
+    } else if (cpuIsa == "avx2") {
+        blurOptions.cpuIsa = CpuIsa::Avx2;
+    } else if (cpuIsa == "avx512") {
+        blurOptions.cpuIsa = CpuIsa::Avx512;
+    } else {
+        std::cout << "invalid cpu instruction set" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::string verticalPass = result["vertical"].as<std::string>();
+    if (verticalPass == "direct") {
+        blurOptions.verticalPass = VerticalPass::Direct;
+    } else if (verticalPass == "transposed") {
+        blurOptions.verticalPass = VerticalPass::Transposed;
+    } else {
+        std::cout << "invalid vertical pass" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::string method = result["method"].as<std::string>();
+    blurOptions.convolve2d = false;
+    if (method == "exact") {
+        blurOptions.method = BlurMethod::Exact;
+    } else if (method == "box3") {
+        blurOptions.method = BlurMethod::Box3;
+    } else if (method == "iir") {
+        blurOptions.method = BlurMethod::Iir;
+    } else if (method == "conv2d") {
+        blurOptions.method = BlurMethod::Exact;
+        blurOptions.convolve2d = true;
+    } else {
+        std::cout << "invalid method" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    blurOptions.psfFile = result["psf"].as<std::string>();
+    std::string convolution = result["convolution"].as<std::string>();
+    if (convolution == "auto") {
+        blurOptions.convolution = ConvolutionAlgorithm::Auto;
+    } else if (convolution == "direct") {
+        blurOptions.convolution = ConvolutionAlgorithm::Direct;
+    } else if (convolution == "fft") {
+        blurOptions.convolution = ConvolutionAlgorithm::Fft;
+    } else {
+        std::cout << "invalid convolution" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::string engineType = result["engine"].as<std::string>();
+    if (engineType == "auto") {
+        blurOptions.engineType = EngineType::Auto;
+    } else if (engineType == "opencl") {
+        blurOptions.engineType = EngineType::OpenCL;
+    } else if (engineType == "cpu") {
+        blurOptions.engineType = EngineType::Cpu;
+    } else {
+        std::cout << "invalid engine" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (blurOptions.allDevices && (result.count("platform") || result.count("device"))) {
+        std::cout << "--all-devices cannot be combined with --platform or --device" << std::endl;
+        exit(EXIT_FAILURE);
+    }
     blurOptions.kernelSize = result["kernelSize"].as<int>();
     blurOptions.sigma = result["sigma"].as<double>();
 
+    blurOptions.cacheDir = result["cache-dir"].as<std::string>();
+    blurOptions.kernelSource = result["kernel-source"].as<std::string>();
+
+    std::string zeroCopy = result["zero-copy"].as<std::string>();
+    if (zeroCopy == "auto") {
+        blurOptions.hostMemory = HostMemory::Auto;
+    } else if (zeroCopy == "on") {
+        blurOptions.hostMemory = HostMemory::ZeroCopy;
+    } else if (zeroCopy == "off") {
+        blurOptions.hostMemory = HostMemory::Copy;
+    } else {
+        std::cout << "invalid zero-copy mode" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::string precision = result["precision"].as<std::string>();
+    if (precision == "double") {
+        blurOptions.precision = Precision::Double;
+    } else if (precision == "float") {
+        blurOptions.precision = Precision::Float;
+    } else if (precision == "half") {
+        blurOptions.precision = Precision::Half;
+    } else if (precision == "fixed") {
+        blurOptions.precision = Precision::Fixed;
+    } else if (precision == "auto") {
+        // resolved once the devices are known
+        blurOptions.precision = Precision::Float;
+    } else {
+        std::cout << "invalid precision" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
     int kernelSize = blurOptions.kernelSize;
     double std_dev = blurOptions.sigma;
 
     // validate the kernel size and the sigma
-    if (kernelSize <= 0 || kernelSize > 9 || kernelSize % 2 == 0) {
+    if (kernelSize <= 0 || kernelSize % 2 == 0) {
         std::cout << "invalid kernel size" << std::endl;
         exit(EXIT_FAILURE);
     }
@@ -51,281 +234,263 @@ int main(int argc, char** argv) {
         exit(EXIT_FAILURE);
     }
 
-    // generate the requested kernel
-    double* blur = _1d_blur_kernel(kernelSize, std_dev);
-
-    // load the tga image
-    tga::TGAImage image;
-    tga::LoadTGA(&image, blurOptions.inFilePath.c_str());
-
-    int imageSize = (int)image.height * (int)image.width;
-    int dataSize = sizeof(unsigned char) * imageSize;
-
-    // generate the image data
-    auto r = std::make_unique<unsigned char[]>(imageSize);
-    auto g = std::make_unique<unsigned char[]>(imageSize);
-    auto b = std::make_unique<unsigned char[]>(imageSize);
-
-    for (int i = 0; i < imageSize; i++) {
-        r[i] = image.imageData[i * 3 + 0];
-        g[i] = image.imageData[i * 3 + 1];
-        b[i] = image.imageData[i * 3 + 2];
+    bool batch = !blurOptions.batchInput.empty();
+    if (!batch && (blurOptions.inFilePath.empty() || blurOptions.outFilePath.empty())) {
+        std::cout << "an input and an output file or a batch are required" << std::endl;
+        exit(EXIT_FAILURE);
     }
 
-    auto rOut = std::make_unique<unsigned char[]>(imageSize);
-    auto gOut = std::make_unique<unsigned char[]>(imageSize);
-    auto bOut = std::make_unique<unsigned char[]>(imageSize);
-
-    // used for checking error status of api calls
-    cl_int status;
-
-    // retrieve the number of platforms
-    cl_uint numPlatforms = 0;
-    checkStatus(clGetPlatformIDs(0, NULL, &numPlatforms));
-
-    if (numPlatforms == 0) {
-        printf("Error: No OpenCL platform available!\n");
+    if (batch && blurOptions.convolve2d) {
+        std::cout << "conv2d can not be combined with --batch" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    // select the platform
-    cl_platform_id platform;
-    checkStatus(clGetPlatformIDs(1, &platform, NULL));
-
-    // retrieve the number of devices
-    cl_uint numDevices = 0;
-    checkStatus(clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 0, NULL, &numDevices));
-
-    if (numDevices == 0) {
-        printf("Error: No OpenCL device available for platform!\n");
+    if (blurOptions.stream && (batch || blurOptions.convolve2d || blurOptions.autotune)) {
+        std::cout << "--stream can not be combined with --batch, conv2d or --autotune" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    // select the device
-    cl_device_id device;
-    checkStatus(clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 1, &device, NULL));
-
-    // output device capabilities
-    size_t maxWorkGroupSize;
-    checkStatus(clGetDeviceInfo(device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &maxWorkGroupSize, NULL));
-    if (maxWorkGroupSize < image.height || maxWorkGroupSize < image.width) {
-        printf("Error: Max work group size is smaller than image dimensions!\n");
+    if (blurOptions.mapFiles && (batch || blurOptions.convolve2d || blurOptions.stream)) {
+        std::cout << "--mmap can not be combined with --batch, conv2d or --stream" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    // create context
-    cl_context context = clCreateContext(NULL, 1, &device, NULL, NULL, &status);
-    checkStatus(status);
-
-    // create command queue
-    cl_command_queue commandQueue = clCreateCommandQueue(context, device, 0, &status);
-    checkStatus(status);
-
-    // create buffers for the image data and the blur kernel
-    cl_mem bufferR = clCreateBuffer(context, CL_MEM_READ_WRITE, dataSize, NULL, &status);
-    checkStatus(status);
-    cl_mem bufferG = clCreateBuffer(context, CL_MEM_READ_WRITE, dataSize, NULL, &status);
-    checkStatus(status);
-    cl_mem bufferB = clCreateBuffer(context, CL_MEM_READ_WRITE, dataSize, NULL, &status);
-    checkStatus(status);
-    cl_mem bufferROut = clCreateBuffer(context, CL_MEM_READ_WRITE, dataSize, NULL, &status);
-    checkStatus(status);
-    cl_mem bufferGOut = clCreateBuffer(context, CL_MEM_READ_WRITE, dataSize, NULL, &status);
-    checkStatus(status);
-    cl_mem bufferBOut = clCreateBuffer(context, CL_MEM_READ_WRITE, dataSize, NULL, &status);
-    checkStatus(status);
-    cl_mem bufferKernelSize = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(int), NULL, &status);
-    checkStatus(status);
-    cl_mem bufferBlurKernel = clCreateBuffer(context, CL_MEM_READ_ONLY, sizeof(double) * kernelSize, NULL, &status);
-    checkStatus(status);
-
-    // enqueue write buffers for the constant data
-    checkStatus(clEnqueueWriteBuffer(commandQueue, bufferR, CL_TRUE, 0, dataSize, r.get(), 0, NULL, NULL));
-    checkStatus(clEnqueueWriteBuffer(commandQueue, bufferG, CL_TRUE, 0, dataSize, g.get(), 0, NULL, NULL));
-    checkStatus(clEnqueueWriteBuffer(commandQueue, bufferB, CL_TRUE, 0, dataSize, b.get(), 0, NULL, NULL));
-    checkStatus(clEnqueueWriteBuffer(commandQueue, bufferKernelSize, CL_TRUE, 0, sizeof(int), &kernelSize, 0, NULL, NULL));
-    checkStatus(clEnqueueWriteBuffer(commandQueue, bufferBlurKernel, CL_TRUE, 0, sizeof(double) * kernelSize, blur, 0, NULL, NULL));
-
-    // read the kernel source
-    const char* kernelFileName = "gauss.cl";
-    std::ifstream ifs(kernelFileName);
-    if (!ifs.good()) {
-        printf("Error: Could not open kernel with file name %s!\n", kernelFileName);
+    if (blurOptions.stripRows < 0) {
+        std::cout << "invalid number of strip rows" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    // load the opencl kernel
-    std::string programSource((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-    const char* programSourceArray = programSource.c_str();
-    size_t programSize = programSource.length();
+    if (blurOptions.inFlightImages <= 0) {
+        std::cout << "invalid number of images in flight" << std::endl;
+        exit(EXIT_FAILURE);
+    }
 
-    // create the program
-    cl_program program = clCreateProgramWithSource(context, 1, static_cast<const char**>(&programSourceArray), &programSize, &status);
-    checkStatus(status);
+    // set up the opencl devices once, the engines can be reused for any number of images
+    EngineOptions engineOptions;
+    engineOptions.programCacheDirectory = blurOptions.cacheDir;
+    engineOptions.kernelFileName = blurOptions.kernelSource;
+    engineOptions.hostMemory = blurOptions.hostMemory;
+    engineOptions.inFlightImages = batch ? blurOptions.inFlightImages : 1;
+    engineOptions.platformIndex = blurOptions.platformIndex;
+    engineOptions.deviceIndex = blurOptions.deviceIndex;
+    engineOptions.tuningFile = blurOptions.tuningFile;
+    engineOptions.verticalPass = blurOptions.verticalPass;
+    CpuEngineOptions cpuOptions;
+    cpuOptions.threads = blurOptions.threads;
+    cpuOptions.isa = blurOptions.cpuIsa;
+    cpuOptions.verticalPass = blurOptions.verticalPass;
+    DeviceScheduler scheduler(engineOptions, blurOptions.engineType, blurOptions.allDevices, cpuOptions);
+    if (precision == "auto") {
+        blurOptions.precision = scheduler.preferredPrecision();
+        precision = precisionName(blurOptions.precision);
+    }
 
-    // build the program
-    status = clBuildProgram(program, 1, &device, NULL, NULL, NULL);
-    if (status != CL_SUCCESS) {
-        printCompilerError(program, device);
+    // tunes every device on a representative image, the first one of a batch
+    auto autotune = [&](const tga::TGAImage& sample) {
+        for (BlurBackend* backend : scheduler.engines(blurOptions.precision)) {
+            // only OpenCL launches have anything to tune
+            BlurEngine* engine = dynamic_cast<BlurEngine*>(backend);
+            if (!engine)
+                continue;
+            TunedLaunch tuned = engine->autotune(sample, kernelSize, std_dev, blurOptions.precision);
+            std::cout << "autotune " << engine->deviceName() << ": horizontal "
+                      << tuned.horizontal.localWorkSize[0] << "x" << tuned.horizontal.localWorkSize[1] << "x" << tuned.horizontal.pixelsPerItem << ", vertical "
+                      << tuned.vertical.localWorkSize[0] << "x" << tuned.vertical.localWorkSize[1] << "x" << tuned.vertical.pixelsPerItem << ", "
+                      << tuned.milliseconds << " ms" << std::endl;
+        }
+    };
+    if (!scheduler.supportsPrecision(blurOptions.precision)) {
+        std::cout << "precision " << precision << " is not supported by any device" << std::endl;
         exit(EXIT_FAILURE);
     }
 
-    // create the vector addition kernel
-    cl_kernel kernel = clCreateKernel(program, "test", &status);
-    checkStatus(status);
-
-    // setting the horizontal kernel arguments
-    checkStatus(clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufferR));
-    checkStatus(clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufferG));
-    checkStatus(clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufferB));
-    checkStatus(clSetKernelArg(kernel, 3, sizeof(cl_mem), &bufferROut));
-    checkStatus(clSetKernelArg(kernel, 4, sizeof(cl_mem), &bufferGOut));
-    checkStatus(clSetKernelArg(kernel, 5, sizeof(cl_mem), &bufferBOut));
-    checkStatus(clSetKernelArg(kernel, 6, sizeof(cl_mem), &bufferKernelSize));
-    checkStatus(clSetKernelArg(kernel, 7, sizeof(cl_mem), &bufferBlurKernel));
-    checkStatus(clSetKernelArg(kernel, 8,  image.width * sizeof(unsigned char), NULL));
-    checkStatus(clSetKernelArg(kernel, 9,  image.width * sizeof(unsigned char), NULL));
-    checkStatus(clSetKernelArg(kernel, 10, image.width * sizeof(unsigned char), NULL));
-
-    size_t globalWorkSize[2] = { (size_t)image.width, (size_t)image.height };
-
-    // run the horizontal program
-    size_t horizontalWorkSize[2] = { (size_t)image.width, 1 };
-    cl_event horizontalClEvent;
-    checkStatus(clEnqueueNDRangeKernel(commandQueue, kernel, 2, NULL, globalWorkSize, horizontalWorkSize, 0, NULL, &horizontalClEvent));
-
-    // setting the vertical kernel arguments
-    checkStatus(clSetKernelArg(kernel, 0, sizeof(cl_mem), &bufferROut));
-    checkStatus(clSetKernelArg(kernel, 1, sizeof(cl_mem), &bufferGOut));
-    checkStatus(clSetKernelArg(kernel, 2, sizeof(cl_mem), &bufferBOut));
-    checkStatus(clSetKernelArg(kernel, 3, sizeof(cl_mem), &bufferR));
-    checkStatus(clSetKernelArg(kernel, 4, sizeof(cl_mem), &bufferG));
-    checkStatus(clSetKernelArg(kernel, 5, sizeof(cl_mem), &bufferB));
-    checkStatus(clSetKernelArg(kernel, 8, image.height * sizeof(unsigned char), NULL));
-    checkStatus(clSetKernelArg(kernel, 9, image.height * sizeof(unsigned char), NULL));
-    checkStatus(clSetKernelArg(kernel, 10, image.height * sizeof(unsigned char), NULL));
-
-    // run the vertical program
-    size_t verticalWorkSize[2] = { 1, (size_t)image.height };
-    checkStatus(clEnqueueNDRangeKernel(commandQueue, kernel, 2, NULL, globalWorkSize, verticalWorkSize, 1, &horizontalClEvent, NULL));
-
-    // read the result of the program
-    checkStatus(clEnqueueReadBuffer(commandQueue, bufferR, CL_TRUE, 0, dataSize, rOut.get(), 0, NULL, NULL));
-    checkStatus(clEnqueueReadBuffer(commandQueue, bufferG, CL_TRUE, 0, dataSize, gOut.get(), 0, NULL, NULL));
-    checkStatus(clEnqueueReadBuffer(commandQueue, bufferB, CL_TRUE, 0, dataSize, bOut.get(), 0, NULL, NULL));
-
-    checkStatus(clReleaseKernel(kernel));
-    checkStatus(clReleaseProgram(program));
-    checkStatus(clReleaseMemObject(bufferR));
-    checkStatus(clReleaseMemObject(bufferG));
-    checkStatus(clReleaseMemObject(bufferB));
-    checkStatus(clReleaseMemObject(bufferROut));
-    checkStatus(clReleaseMemObject(bufferGOut));
-    checkStatus(clReleaseMemObject(bufferBOut));
-    checkStatus(clReleaseMemObject(bufferKernelSize));
-    checkStatus(clReleaseMemObject(bufferBlurKernel));
-    checkStatus(clReleaseCommandQueue(commandQueue));
-    checkStatus(clReleaseContext(context));
-
-    // write the result into the tga image vector
-    for (int i = 0; i < imageSize; i++) {
-        image.imageData[i * 3 + 0] = rOut[i];
-        image.imageData[i * 3 + 1] = gOut[i];
-        image.imageData[i * 3 + 2] = bOut[i];
+    if (batch) {
+        std::vector<BatchJob> jobs = collectBatchJobs(blurOptions.batchInput, blurOptions.outputDirectory);
+        if (jobs.empty()) {
+            std::cout << "no images found for " << blurOptions.batchInput << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        if (blurOptions.autotune) {
+            tga::TGAImage sample;
+            if (tga::LoadTGA(&sample, jobs[0].inFilePath.c_str()))
+                autotune(sample);
+        }
+
+        BatchOptions batchOptions;
+        batchOptions.kernelSize = kernelSize;
+        batchOptions.sigma = std_dev;
+        batchOptions.precision = blurOptions.precision;
+        batchOptions.method = blurOptions.method;
+        batchOptions.readerThreads = blurOptions.readerThreads;
+        batchOptions.writerThreads = blurOptions.writerThreads;
+        std::vector<BlurBackend*> engines = scheduler.engines(blurOptions.precision);
+        BatchResult batchResult = runBatch(engines, jobs, batchOptions);
+
+        std::cout << "batch: " << batchResult.blurred << " images in " << batchResult.seconds << " s, "
+                  << (batchResult.seconds > 0 ? batchResult.blurred / batchResult.seconds : 0.0) << " images/s";
+        if (batchResult.failed > 0)
+            std::cout << ", " << batchResult.failed << " failed";
+        std::cout << std::endl;
+        if (engines.size() > 1) {
+            for (size_t i = 0; i < engines.size(); i++)
+                std::cout << "  " << engines[i]->deviceName() << ": " << batchResult.blurredPerEngine[i] << " images" << std::endl;
+        }
+        return batchResult.failed > 0 ? EXIT_FAILURE : 0;
     }
 
-    tga::saveTGA(image, blurOptions.outFilePath.c_str());
-
-    return 0;
-}
+    if (blurOptions.stream) {
+        StreamOptions streamOptions;
+        streamOptions.kernelSize = kernelSize;
+        streamOptions.sigma = std_dev;
+        streamOptions.precision = blurOptions.precision;
+        streamOptions.method = blurOptions.method;
+        streamOptions.stripRows = blurOptions.stripRows;
+        StreamResult streamed = blurStreamed(scheduler, blurOptions.inFilePath, blurOptions.outFilePath, streamOptions);
+        if (!streamed.succeeded)
+            exit(EXIT_FAILURE);
+
+        std::cout << "blur streamed " << streamed.width << "x" << streamed.height << " in " << streamed.strips << " strips of " << streamed.stripRows << " rows ("
+                  << (blurOptions.method != BlurMethod::Exact ? std::string(methodName(blurOptions.method)) + ", " : std::string()) << precision << "): "
+                  << streamed.seconds * 1000.0 << " ms, peak strip memory " << streamed.peakBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+        return 0;
+    }
 
-std::string cl_errorstring(cl_int err)
-{
-    switch (err)
-    {
-    case CL_SUCCESS:									return std::string("Success");
-    case CL_DEVICE_NOT_FOUND:							return std::string("Device not found");
-    case CL_DEVICE_NOT_AVAILABLE:						return std::string("Device not available");
-    case CL_COMPILER_NOT_AVAILABLE:						return std::string("Compiler not available");
-    case CL_MEM_OBJECT_ALLOCATION_FAILURE:				return std::string("Memory object allocation failure");
-    case CL_OUT_OF_RESOURCES:							return std::string("Out of resources");
-    case CL_OUT_OF_HOST_MEMORY:							return std::string("Out of host memory");
-    case CL_PROFILING_INFO_NOT_AVAILABLE:				return std::string("Profiling information not available");
-    case CL_MEM_COPY_OVERLAP:							return std::string("Memory copy overlap");
-    case CL_IMAGE_FORMAT_MISMATCH:						return std::string("Image format mismatch");
-    case CL_IMAGE_FORMAT_NOT_SUPPORTED:					return std::string("Image format not supported");
-    case CL_BUILD_PROGRAM_FAILURE:						return std::string("Program build failure");
-    case CL_MAP_FAILURE:								return std::string("Map failure");
-    case CL_MISALIGNED_SUB_BUFFER_OFFSET:				return std::string("Misaligned sub buffer offset");
-    case CL_EXEC_STATUS_ERROR_FOR_EVENTS_IN_WAIT_LIST:	return std::string("Exec status error for events in wait list");
-    case CL_INVALID_VALUE:                    			return std::string("Invalid value");
-    case CL_INVALID_DEVICE_TYPE:              			return std::string("Invalid device type");
-    case CL_INVALID_PLATFORM:                 			return std::string("Invalid platform");
-    case CL_INVALID_DEVICE:                   			return std::string("Invalid device");
-    case CL_INVALID_CONTEXT:                  			return std::string("Invalid context");
-    case CL_INVALID_QUEUE_PROPERTIES:         			return std::string("Invalid queue properties");
-    case CL_INVALID_COMMAND_QUEUE:            			return std::string("Invalid command queue");
-    case CL_INVALID_HOST_PTR:                 			return std::string("Invalid host pointer");
-    case CL_INVALID_MEM_OBJECT:               			return std::string("Invalid memory object");
-    case CL_INVALID_IMAGE_FORMAT_DESCRIPTOR:  			return std::string("Invalid image format descriptor");
-    case CL_INVALID_IMAGE_SIZE:               			return std::string("Invalid image size");
-    case CL_INVALID_SAMPLER:                  			return std::string("Invalid sampler");
-    case CL_INVALID_BINARY:                   			return std::string("Invalid binary");
-    case CL_INVALID_BUILD_OPTIONS:            			return std::string("Invalid build options");
-    case CL_INVALID_PROGRAM:                  			return std::string("Invalid program");
-    case CL_INVALID_PROGRAM_EXECUTABLE:       			return std::string("Invalid program executable");
-    case CL_INVALID_KERNEL_NAME:              			return std::string("Invalid kernel name");
-    case CL_INVALID_KERNEL_DEFINITION:        			return std::string("Invalid kernel definition");
-    case CL_INVALID_KERNEL:                   			return std::string("Invalid kernel");
-    case CL_INVALID_ARG_INDEX:                			return std::string("Invalid argument index");
-    case CL_INVALID_ARG_VALUE:                			return std::string("Invalid argument value");
-    case CL_INVALID_ARG_SIZE:                 			return std::string("Invalid argument size");
-    case CL_INVALID_KERNEL_ARGS:             			return std::string("Invalid kernel arguments");
-    case CL_INVALID_WORK_DIMENSION:          			return std::string("Invalid work dimension");
-    case CL_INVALID_WORK_GROUP_SIZE:          			return std::string("Invalid work group size");
-    case CL_INVALID_WORK_ITEM_SIZE:           			return std::string("Invalid work item size");
-    case CL_INVALID_GLOBAL_OFFSET:            			return std::string("Invalid global offset");
-    case CL_INVALID_EVENT_WAIT_LIST:          			return std::string("Invalid event wait list");
-    case CL_INVALID_EVENT:                    			return std::string("Invalid event");
-    case CL_INVALID_OPERATION:                			return std::string("Invalid operation");
-    case CL_INVALID_GL_OBJECT:                			return std::string("Invalid OpenGL object");
-    case CL_INVALID_BUFFER_SIZE:              			return std::string("Invalid buffer size");
-    case CL_INVALID_MIP_LEVEL:                			return std::string("Invalid mip-map level");
-    case CL_INVALID_GLOBAL_WORK_SIZE:         			return std::string("Invalid gloal work size");
-    case CL_INVALID_PROPERTY:                 			return std::string("Invalid property");
-    default:                                  			return std::string("Unknown error code");
+    if (blurOptions.mapFiles) {
+        // the pixels are copied from the mapped input into the mapped output once and blurred there.
+        // The output is a temporary file that replaces outFilePath after the unmap, creating
+        // outFilePath itself would truncate the input if both are the same file.
+        auto mapStart = std::chrono::high_resolution_clock::now();
+        tga::MappedTGA input, output;
+        if (!input.openRead(blurOptions.inFilePath.c_str()))
+            exit(EXIT_FAILURE);
+        const tga::TGAImage& source = input.image();
+        std::string temporaryOutPath = temporaryPath(blurOptions.outFilePath);
+        if (!output.create(temporaryOutPath.c_str(), source.width, source.height, source.bpp)) {
+            std::error_code error;
+            std::filesystem::remove(temporaryOutPath, error);
+            exit(EXIT_FAILURE);
+        }
+        memcpy(output.image().data(), source.data(), source.dataSize());
+        input.close();
+        auto mapEnd = std::chrono::high_resolution_clock::now();
+        std::cout << "map: " << std::chrono::duration<double, std::milli>(mapEnd - mapStart).count() << " ms" << std::endl;
+
+        if (blurOptions.autotune)
+            autotune(output.image());
+
+        auto start = std::chrono::high_resolution_clock::now();
+        scheduler.blur(output.image(), kernelSize, std_dev, blurOptions.precision, blurOptions.method);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "blur (" << (blurOptions.method != BlurMethod::Exact ? std::string(methodName(blurOptions.method)) + ", " : std::string()) << precision << ", mapped)"
+                  << (scheduler.deviceCount() == 1 ? " on " + scheduler.engine(0).deviceName() : std::string()) << ": " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+        auto unmapStart = std::chrono::high_resolution_clock::now();
+        output.close();
+        if (!replaceWithTemporary(temporaryOutPath, blurOptions.outFilePath)) {
+            std::cout << "saveTGA: error writing file " << blurOptions.outFilePath << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        auto unmapEnd = std::chrono::high_resolution_clock::now();
+        std::cout << "unmap: " << std::chrono::duration<double, std::milli>(unmapEnd - unmapStart).count() << " ms" << std::endl;
+        return 0;
     }
-}
 
-void checkStatus(cl_int err)
-{
-    if (err != CL_SUCCESS) {
-        printf("OpenCL Error: %s \n", cl_errorstring(err).c_str());
+    // load the tga image
+    auto loadStart = std::chrono::high_resolution_clock::now();
+    tga::TGAImage image;
+    if (!tga::LoadTGA(&image, blurOptions.inFilePath.c_str()))
         exit(EXIT_FAILURE);
+    auto loadEnd = std::chrono::high_resolution_clock::now();
+    std::cout << "load: " << std::chrono::duration<double, std::milli>(loadEnd - loadStart).count() << " ms" << std::endl;
+
+    if (blurOptions.autotune)
+        autotune(image);
+
+    if (blurOptions.convolve2d) {
+        // without a psf the 2D gaussian has to match the separable blur
+        Kernel2D kernel;
+        bool gaussian = blurOptions.psfFile.empty();
+        if (gaussian)
+            kernel = gaussianKernel2D(kernelSize, std_dev);
+        else if (!loadKernel2D(kernel, blurOptions.psfFile))
+            exit(EXIT_FAILURE);
+
+        tga::TGAImage separable;
+        if (gaussian)
+            separable = image;
+
+        ConvolutionPlan plan = planConvolution(kernel, (int)image.width, (int)image.height, blurOptions.convolution);
+        auto start = std::chrono::high_resolution_clock::now();
+        scheduler.convolve(image, kernel, plan, blurOptions.precision);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "convolve " << kernel.width << "x" << kernel.height << " (" << convolutionAlgorithmName(plan.algorithm);
+        if (plan.algorithm == ConvolutionAlgorithm::Fft)
+            std::cout << " " << plan.fftSize << "x" << plan.fftSize << " tiles";
+        std::cout << ", " << precision << "): " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+
+        if (gaussian) {
+            scheduler.blur(separable, kernelSize, std_dev, blurOptions.precision);
+
+            int maxDifference = 0;
+            for (size_t i = 0; i < image.imageData.size(); i++) {
+                int difference = std::abs((int)image.imageData[i] - (int)separable.imageData[i]);
+                if (difference > maxDifference)
+                    maxDifference = difference;
+            }
+            std::cout << "max absolute difference to the separable blur: " << maxDifference << std::endl;
+        }
+
+        tga::saveTGAInPlace(image, blurOptions.outFilePath.c_str());
+        return 0;
     }
-}
-
-void printCompilerError(cl_program program, cl_device_id device)
-{
-    cl_int status;
-    size_t logSize;
-    char* log;
 
-    // get log size
-    status = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &logSize);
-    checkStatus(status);
+    // keep the original around to compare the precision against a double precision blur,
+    // approximations are compared against the exact kernel in the same precision
+    tga::TGAImage reference;
+    bool approximate = blurOptions.method != BlurMethod::Exact;
+    bool compareToDouble = blurOptions.precision != Precision::Double && scheduler.supportsPrecision(Precision::Double);
+    if (compareToDouble || approximate)
+        reference = image;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    scheduler.blur(image, kernelSize, std_dev, blurOptions.precision, blurOptions.method);
+    auto end = std::chrono::high_resolution_clock::now();
+    bool usesZeroCopy = scheduler.deviceCount() == 1 && scheduler.engine(0).usesZeroCopy();
+    std::cout << "blur (" << (approximate ? std::string(methodName(blurOptions.method)) + ", " : std::string()) << precision << (usesZeroCopy ? ", zero copy" : "") << ")"
+              << (scheduler.deviceCount() == 1 ? " on " + scheduler.engine(0).deviceName() : std::string()) << ": " << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+    if (scheduler.deviceCount() > 1) {
+        for (int i = 0; i < scheduler.deviceCount(); i++)
+            std::cout << "  " << scheduler.engine(i).deviceName() << ": " << scheduler.throughput(i) / 1e6 << " MPixel/s" << std::endl;
+    }
 
-    // allocate space for log
-    log = static_cast<char*>(malloc(logSize));
-    if (!log)
-    {
-        exit(EXIT_FAILURE);
+    if (approximate) {
+        scheduler.blur(reference, kernelSize, std_dev, blurOptions.precision);
+
+        double squares = 0.0;
+        for (size_t i = 0; i < image.imageData.size(); i++) {
+            double difference = (double)image.imageData[i] - (double)reference.imageData[i];
+            squares += difference * difference;
+        }
+        std::cout << "rms error to the exact kernel: " << (image.imageData.empty() ? 0.0 : std::sqrt(squares / image.imageData.size())) << std::endl;
+    } else if (compareToDouble) {
+        scheduler.blur(reference, kernelSize, std_dev, Precision::Double);
+
+        int maxDifference = 0;
+        for (size_t i = 0; i < image.imageData.size(); i++) {
+            int difference = std::abs((int)image.imageData[i] - (int)reference.imageData[i]);
+            if (difference > maxDifference)
+                maxDifference = difference;
+        }
+        std::cout << "max absolute difference to double: " << maxDifference << std::endl;
     }
 
-    // read the log
-    status = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, logSize, log, NULL);
-    checkStatus(status);
+    // the blurred image is not needed after it has been written, it is swapped to BGR in place
+    auto saveStart = std::chrono::high_resolution_clock::now();
+    tga::saveTGAInPlace(image, blurOptions.outFilePath.c_str());
+    auto saveEnd = std::chrono::high_resolution_clock::now();
+    double saveSeconds = std::chrono::duration<double>(saveEnd - saveStart).count();
+    std::cout << "save: " << saveSeconds * 1000.0 << " ms, " << (saveSeconds > 0 ? image.dataSize() / (1024.0 * 1024.0) / saveSeconds : 0.0) << " MB/s" << std::endl;
 
-    // print the log
-    printf("Build Error: %s\n", log);
+    return 0;
 }
@@ -0,0 +1,136 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+bool MappedFile::openRead(const char* filename) {
+    close();
+
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = NULL;
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        close();
+        return false;
+    }
+
+    fileMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    mapping = fileMapping ? static_cast<unsigned char*>(MapViewOfFile(fileMapping, FILE_MAP_READ, 0, 0, 0)) : NULL;
+    if (!mapping) {
+        close();
+        return false;
+    }
+
+    mappedSize = (size_t)size.QuadPart;
+    return true;
+}
+
+bool MappedFile::create(const char* filename, size_t size) {
+    close();
+
+    file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        file = NULL;
+        return false;
+    }
+
+    // the mapping grows the file to its size
+    unsigned long long size64 = size;
+    fileMapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)(size64 >> 32), (DWORD)size64, NULL);
+    mapping = fileMapping ? static_cast<unsigned char*>(MapViewOfFile(fileMapping, FILE_MAP_WRITE, 0, 0, size)) : NULL;
+    if (!mapping) {
+        close();
+        return false;
+    }
+
+    mappedSize = size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping)
+        UnmapViewOfFile(mapping);
+    if (fileMapping)
+        CloseHandle(fileMapping);
+    if (file)
+        CloseHandle(file);
+
+    mapping = NULL;
+    fileMapping = NULL;
+    file = NULL;
+    mappedSize = 0;
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MappedFile::openRead(const char* filename) {
+    close();
+
+    descriptor = open(filename, O_RDONLY);
+    if (descriptor < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        close();
+        return false;
+    }
+
+    void* address = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (address == MAP_FAILED) {
+        close();
+        return false;
+    }
+
+    mapping = static_cast<unsigned char*>(address);
+    mappedSize = (size_t)status.st_size;
+    // the file is read front to back once, read ahead generously
+    madvise(mapping, mappedSize, MADV_SEQUENTIAL);
+    return true;
+}
+
+bool MappedFile::create(const char* filename, size_t size) {
+    close();
+
+    descriptor = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (descriptor < 0)
+        return false;
+
+    // reserving the blocks up front turns a full disk into an error here instead of a signal
+    // when a page is written back
+#if defined(__linux__)
+    bool reserved = posix_fallocate(descriptor, 0, (off_t)size) == 0;
+#else
+    bool reserved = ftruncate(descriptor, (off_t)size) == 0;
+#endif
+    void* address = reserved ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0) : MAP_FAILED;
+    if (address == MAP_FAILED) {
+        close();
+        return false;
+    }
+
+    mapping = static_cast<unsigned char*>(address);
+    mappedSize = size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping)
+        munmap(mapping, mappedSize);
+    if (descriptor >= 0)
+        ::close(descriptor);
+
+    mapping = NULL;
+    mappedSize = 0;
+    descriptor = -1;
+}
+#endif
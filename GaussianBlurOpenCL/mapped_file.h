@@ -0,0 +1,39 @@
+#ifndef GAUSSIAN_BLUR_MAPPED_FILE_H
+#define GAUSSIAN_BLUR_MAPPED_FILE_H
+
+#include <stddef.h>
+
+// A whole file mapped into memory. The pages are read from disk when they are first touched and
+// written back by the operating system, there is no copy in between and no buffer to allocate.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // maps an existing file read only
+    bool openRead(const char* filename);
+
+    // creates the file with size bytes reserved on disk and maps it for writing
+    bool create(const char* filename, size_t size);
+
+    // unmaps the file, the operating system writes the pages of a writable mapping back
+    void close();
+
+    unsigned char* data() const { return mapping; }
+    size_t size() const { return mappedSize; }
+
+private:
+    unsigned char* mapping = NULL;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    void* file = NULL;
+    void* fileMapping = NULL;
+#else
+    int descriptor = -1;
+#endif
+};
+
+#endif //GAUSSIAN_BLUR_MAPPED_FILE_H
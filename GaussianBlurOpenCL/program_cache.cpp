@@ -0,0 +1,184 @@
+#include "program_cache.h"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "temporary_file.h"
+
+// identifies the file format, bump it if the layout of an entry changes
+static const char cacheMagic[8] = { 'G', 'B', 'L', 'U', 'R', 'C', 'L', '1' };
+
+// 64 bit FNV-1a, good enough to tell kernel sources and keys apart
+static uint64_t fnv1a(const std::string& data, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static std::string toHex(uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        hex[i] = digits[value & 0xf];
+        value >>= 4;
+    }
+    return hex;
+}
+
+static std::string platformString(cl_platform_id platform, cl_platform_info param) {
+    size_t size = 0;
+    if (clGetPlatformInfo(platform, param, 0, NULL, &size) != CL_SUCCESS || size == 0)
+        return std::string();
+    std::string value(size, '\0');
+    clGetPlatformInfo(platform, param, size, &value[0], NULL);
+    value.resize(size - 1);
+    return value;
+}
+
+static std::string deviceString(cl_device_id device, cl_device_info param) {
+    size_t size = 0;
+    if (clGetDeviceInfo(device, param, 0, NULL, &size) != CL_SUCCESS || size == 0)
+        return std::string();
+    std::string value(size, '\0');
+    clGetDeviceInfo(device, param, size, &value[0], NULL);
+    value.resize(size - 1);
+    return value;
+}
+
+ProgramCache::ProgramCache(const std::string& directory) : directory(directory) {
+    if (directory.empty())
+        return;
+
+    // a cache directory that can not be created just disables the cache
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        printf("Warning: Could not create the program cache directory %s, caching is disabled!\n", directory.c_str());
+        this->directory.clear();
+    }
+}
+
+std::string ProgramCache::cacheKey(cl_platform_id platform, cl_device_id device, const std::string& source, const std::string& buildOptions) const {
+    std::string key;
+    key += platformString(platform, CL_PLATFORM_NAME) + "\n";
+    key += platformString(platform, CL_PLATFORM_VERSION) + "\n";
+    key += deviceString(device, CL_DEVICE_NAME) + "\n";
+    key += deviceString(device, CL_DRIVER_VERSION) + "\n";
+    key += buildOptions + "\n";
+    key += toHex(fnv1a(source));
+    return key;
+}
+
+std::string ProgramCache::cachePath(const std::string& key) const {
+    return (std::filesystem::path(directory) / (toHex(fnv1a(key)) + ".bin")).string();
+}
+
+cl_program ProgramCache::load(cl_context context, cl_device_id device, const std::string& key, const std::string& buildOptions) const {
+    std::ifstream file(cachePath(key), std::ios::in | std::ios::binary);
+    if (!file.good())
+        return NULL;
+
+    // an entry starts with the magic and the full key, which guards against hash collisions
+    char magic[sizeof(cacheMagic)];
+    uint64_t keySize = 0;
+    uint64_t binarySize = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
+    if (!file.good() || memcmp(magic, cacheMagic, sizeof(cacheMagic)) != 0 || keySize != key.size())
+        return NULL;
+
+    std::string storedKey(keySize, '\0');
+    file.read(&storedKey[0], keySize);
+    file.read(reinterpret_cast<char*>(&binarySize), sizeof(binarySize));
+    if (!file.good() || storedKey != key || binarySize == 0)
+        return NULL;
+
+    std::vector<unsigned char> binary(binarySize);
+    file.read(reinterpret_cast<char*>(binary.data()), binarySize);
+    if (!file.good())
+        return NULL;
+
+    cl_int status;
+    cl_int binaryStatus;
+    size_t size = binary.size();
+    const unsigned char* binaryData = binary.data();
+    cl_program program = clCreateProgramWithBinary(context, 1, &device, &size, &binaryData, &binaryStatus, &status);
+    if (status != CL_SUCCESS || binaryStatus != CL_SUCCESS) {
+        if (program) clReleaseProgram(program);
+        return NULL;
+    }
+
+    // a binary program still has to be built, this is cheap compared to compiling the source
+    if (clBuildProgram(program, 1, &device, buildOptions.c_str(), NULL, NULL) != CL_SUCCESS) {
+        clReleaseProgram(program);
+        return NULL;
+    }
+
+    return program;
+}
+
+void ProgramCache::store(cl_program program, const std::string& key) const {
+    size_t binarySize = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &binarySize, NULL) != CL_SUCCESS || binarySize == 0)
+        return;
+
+    std::vector<unsigned char> binary(binarySize);
+    unsigned char* binaryData = binary.data();
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*), &binaryData, NULL) != CL_SUCCESS)
+        return;
+
+    // write to a temporary file of this thread first so a concurrent run never sees half an entry
+    std::string path = cachePath(key);
+    std::string temporary = temporaryPath(path);
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::trunc | std::ios::binary);
+        uint64_t keySize = key.size();
+        uint64_t size = binarySize;
+        file.write(cacheMagic, sizeof(cacheMagic));
+        file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+        file.write(key.data(), key.size());
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+        file.close();
+        if (!file.good()) {
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+
+    replaceWithTemporary(temporary, path);
+}
+
+cl_program ProgramCache::build(cl_context context, cl_platform_id platform, cl_device_id device,
+                               const std::string& source, const std::string& buildOptions) {
+    std::string key;
+    if (!directory.empty()) {
+        key = cacheKey(platform, device, source, buildOptions);
+        cl_program program = load(context, device, key, buildOptions);
+        if (program)
+            return program;
+    }
+
+    // nothing usable in the cache, build from source
+    cl_int status;
+    const char* programSourceArray = source.c_str();
+    size_t programSize = source.length();
+
+    cl_program program = clCreateProgramWithSource(context, 1, static_cast<const char**>(&programSourceArray), &programSize, &status);
+    checkStatus(status);
+
+    status = clBuildProgram(program, 1, &device, buildOptions.c_str(), NULL, NULL);
+    if (status != CL_SUCCESS) {
+        printCompilerError(program, device);
+        exit(EXIT_FAILURE);
+    }
+
+    if (!directory.empty())
+        store(program, key);
+
+    return program;
+}
@@ -0,0 +1,28 @@
+#ifndef GAUSSIAN_BLUR_PROGRAM_CACHE_H
+#define GAUSSIAN_BLUR_PROGRAM_CACHE_H
+
+#include <string>
+#include "cl_utils.h"
+
+// Stores built OpenCL programs on disk so that later runs can skip clBuildProgram.
+// Entries are keyed by platform, device name, driver version, build options and a hash of
+// the kernel source. An entry that no longer loads or builds is treated as stale and replaced.
+class ProgramCache {
+public:
+    // an empty directory disables the cache
+    explicit ProgramCache(const std::string& directory = "");
+
+    // loads the program from the cache or builds it from source and stores the binary
+    cl_program build(cl_context context, cl_platform_id platform, cl_device_id device,
+                     const std::string& source, const std::string& buildOptions);
+
+private:
+    std::string cacheKey(cl_platform_id platform, cl_device_id device, const std::string& source, const std::string& buildOptions) const;
+    std::string cachePath(const std::string& key) const;
+    cl_program load(cl_context context, cl_device_id device, const std::string& key, const std::string& buildOptions) const;
+    void store(cl_program program, const std::string& key) const;
+
+    std::string directory;
+};
+
+#endif //GAUSSIAN_BLUR_PROGRAM_CACHE_H
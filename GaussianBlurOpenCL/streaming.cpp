@@ -0,0 +1,171 @@
+#include "streaming.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "blocking_queue.h"
+#include "temporary_file.h"
+#include "tga_stream.h"
+
+// strips of about this size keep the devices busy without holding much of the image
+static const size_t targetStripBytes = 16 << 20;
+
+// strips need some height of their own, and a few times the halo so it does not dominate
+static const int minStripRows = 64;
+static const int haloFactor = 4;
+
+// a strip on its way through the pipeline, the image holds the rows from top including the halo
+struct StreamStrip {
+    std::unique_ptr<tga::TGAImage> image;
+    int top = 0;
+    int first = 0;
+    int last = 0;
+};
+
+// counts the bytes of the strips that are alive
+class StripMemory {
+public:
+    void allocated(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        live += bytes;
+        peak = std::max(peak, live);
+    }
+
+    void released(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        live -= bytes;
+    }
+
+    size_t peakBytes() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return peak;
+    }
+
+private:
+    std::mutex mutex;
+    size_t live = 0;
+    size_t peak = 0;
+};
+
+StreamResult blurStreamed(DeviceScheduler& scheduler, const std::string& inFilePath, const std::string& outFilePath, const StreamOptions& options) {
+    StreamResult result;
+
+    tga::TGAStripReader reader;
+    if (!reader.open(inFilePath.c_str()))
+        return result;
+
+    int height = (int)reader.height();
+    size_t rowSize = reader.rowSize();
+    int radius = blurRadius(options.method, options.kernelSize, options.sigma);
+
+    int stripRows = options.stripRows;
+    if (stripRows <= 0)
+        stripRows = std::max((int)(targetStripBytes / rowSize), std::max(minStripRows, haloFactor * radius));
+    stripRows = std::min(stripRows, height);
+
+    // the rows go to a temporary file that replaces the output once it is complete, the output
+    // may be the input, and a failed strip must not leave half an image behind
+    std::string temporaryOutPath = temporaryPath(outFilePath);
+    tga::TGAStripWriter writer;
+    if (!writer.open(temporaryOutPath.c_str(), reader.width(), reader.height(), reader.bpp())) {
+        std::error_code error;
+        std::filesystem::remove(temporaryOutPath, error);
+        return result;
+    }
+
+    result.width = reader.width();
+    result.height = reader.height();
+    result.stripRows = stripRows;
+    result.strips = (height + stripRows - 1) / stripRows;
+
+    BlockingQueue<StreamStrip> loaded(1);
+    BlockingQueue<StreamStrip> blurred(1);
+    std::atomic<bool> failed(false);
+    StripMemory memory;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // reader stage. A strip writes the rows first to last and reads radius rows more on both
+    // sides, clamped to the image. The rows from the top of the next strip on are kept before
+    // the strip is blurred in place, they are the start of the next strip.
+    std::thread readerThread([&]() {
+        std::vector<unsigned char> carry;
+        for (int first = 0; first < height && !failed; first += stripRows) {
+            StreamStrip strip;
+            strip.first = first;
+            strip.last = std::min(first + stripRows, height);
+            strip.top = std::max(first - radius, 0);
+            int bottom = std::min(strip.last + radius, height);
+
+            strip.image.reset(new tga::TGAImage());
+            tga::TGAImage& image = *strip.image;
+            image.bpp = reader.bpp();
+            image.type = reader.bpp() == 32 ? 1 : 0;
+            image.width = reader.width();
+            image.height = bottom - strip.top;
+            image.imageData.resize(image.height * rowSize);
+            memory.allocated(image.imageData.size());
+
+            std::copy(carry.begin(), carry.end(), image.imageData.begin());
+            int readFrom = (int)reader.rowsRead();
+            if (!reader.readRows(image.imageData.data() + (readFrom - strip.top) * rowSize, bottom - readFrom)) {
+                failed = true;
+                memory.released(image.imageData.size());
+                break;
+            }
+
+            int nextTop = std::max(strip.last - radius, 0);
+            carry.assign(image.imageData.begin() + (nextTop - strip.top) * rowSize, image.imageData.end());
+            loaded.push(std::move(strip));
+        }
+        loaded.close();
+    });
+
+    // writer stage, appends the rows the strips own
+    std::thread writerThread([&]() {
+        StreamStrip strip;
+        while (blurred.pop(strip)) {
+            const tga::ImageData& data = strip.image->imageData;
+            if (!failed && !writer.writeRows(&data[(strip.first - strip.top) * rowSize], strip.last - strip.first)) {
+                std::cout << "saveTGA: error writing " << outFilePath << std::endl;
+                failed = true;
+            }
+            memory.released(data.size());
+            strip.image.reset();
+        }
+    });
+
+    // the scheduler blurs one strip at a time, on all of its devices
+    StreamStrip strip;
+    while (loaded.pop(strip)) {
+        if (!failed)
+            scheduler.blur(*strip.image, options.kernelSize, options.sigma, options.precision, options.method);
+        blurred.push(std::move(strip));
+    }
+    blurred.close();
+
+    readerThread.join();
+    writerThread.join();
+    bool written = writer.close();
+    reader.close();
+
+    if (!failed && written) {
+        written = replaceWithTemporary(temporaryOutPath, outFilePath);
+        if (!written)
+            std::cout << "saveTGA: error writing " << outFilePath << std::endl;
+    } else {
+        std::error_code error;
+        std::filesystem::remove(temporaryOutPath, error);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    result.succeeded = !failed && written;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    result.peakBytes = memory.peakBytes();
+    return result;
+}
@@ -0,0 +1,38 @@
+#ifndef GAUSSIAN_BLUR_STREAMING_H
+#define GAUSSIAN_BLUR_STREAMING_H
+
+#include <string>
+#include "blur_backend.h"
+#include "device_scheduler.h"
+
+struct StreamOptions {
+    int kernelSize = 0;
+    double sigma = 0.0;
+    Precision precision = Precision::Float;
+    BlurMethod method = BlurMethod::Exact;
+    // rows every strip writes, 0 picks them from the row size
+    int stripRows = 0;
+};
+
+struct StreamResult {
+    bool succeeded = false;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    int strips = 0;
+    int stripRows = 0;
+    double seconds = 0.0;
+    // the most bytes of strip buffers alive at the same time
+    size_t peakBytes = 0;
+};
+
+// Blurs an image that does not have to fit into host or device memory. A reader thread reads
+// the input in horizontal strips and adds the radius rows of halo above and below that the
+// vertical pass needs, the halo above and the overlap with the next strip are carried over
+// from the rows already read, so every row is read once. The scheduler blurs one strip at a
+// time while a writer thread appends the rows each strip owns to the output. At most five
+// strips are alive: one being read, one being blurred and one being written, and one waiting
+// in front of the blur and the writer each. The output replaces outFilePath only once all rows
+// have been written, so it may be the input.
+StreamResult blurStreamed(DeviceScheduler& scheduler, const std::string& inFilePath, const std::string& outFilePath, const StreamOptions& options);
+
+#endif //GAUSSIAN_BLUR_STREAMING_H
@@ -0,0 +1,28 @@
+#include "temporary_file.h"
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+std::string temporaryPath(const std::string& path) {
+    static std::atomic<unsigned long> counter(0);
+    size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return path + "." + std::to_string(getpid()) + "." + std::to_string(thread) + "." + std::to_string(counter++) + ".tmp";
+}
+
+bool replaceWithTemporary(const std::string& temporaryPath, const std::string& path) {
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,14 @@
+#ifndef GAUSSIAN_BLUR_TEMPORARY_FILE_H
+#define GAUSSIAN_BLUR_TEMPORARY_FILE_H
+
+#include <string>
+
+// A file name in the directory of path that no other process or thread uses at the same time,
+// made of the process id, the thread and a counter. Files are written there and then renamed
+// over path, the rename replaces path at once, so a reader sees the old or the new file.
+std::string temporaryPath(const std::string& path);
+
+// renames the temporary file over path, the temporary file is removed if that fails
+bool replaceWithTemporary(const std::string& temporaryPath, const std::string& path);
+
+#endif //GAUSSIAN_BLUR_TEMPORARY_FILE_H
@@ -4,6 +4,9 @@
 #include <stdlib.h>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include "cpu_kernels.h"
 
 // Uncompressed TGA Header
 const unsigned char uTGAcompare[12] = {0,0, 2,0,0,0,0,0,0,0,0,0};
@@ -11,53 +14,75 @@ const unsigned char uTGAcompare[12] = {0,0, 2,0,0,0,0,0,0,0,0,0};
 const unsigned char cTGAcompare[12] = {0,0,10,0,0,0,0,0,0,0,0,0};
 
 
-bool tga::saveTGA(const TGAImage& image, const char * filename)
+// Pixels swapped and written per call, large enough that the calls cost nothing next to the
+// copy. The buffer of every thread is kept, batch writers save one image after another
+static const size_t writeBlockSize = 1 << 20;
+
+// write the 18 byte header of an uncompressed tga
+static FILE* createTGA(const tga::TGAImage& image, const char * filename)
 {
-	const unsigned int bytesPerPixel = image.bpp / 8;
-
-	std::ofstream myfile;
-	myfile.open (filename, std::ios::out | std::ios::trunc | std::ios::binary);
-	//create the tga header
-	unsigned char header[6];
-	// 1x1 image
-	header[0] = image.width % 256;
-	header[1] = image.width / 256;
-	header[2] = image.height % 256;
-	header[3] = image.height / 256;
-	header[4] = image.bpp;
-	header[5] = image.bpp == 32 ? 8 : 0; //flag alpha depth and other flags
-
-	//add the headers
-	for (int i = 0; i < 12; ++i)
-	{
-		myfile << uTGAcompare[i];
-	}
-	for (int i = 0; i < 6; ++i)
+	FILE * file = fopen(filename, "wb");
+	if(file == NULL)
 	{
-		myfile << header[i];
+		std::cout << "saveTGA: error writing file " << filename << std::endl;
+		return NULL;
 	}
-	//myfile << header;
-	//add the image data
-	std::vector<unsigned char> imageData(image.imageData); 
 
-	//swap from RGB to BGR
-	// Start The Loop
-	for(unsigned int cswap = 0; cswap < imageData.size(); cswap += bytesPerPixel)
+	unsigned char header[18];
+	memcpy(header, uTGAcompare, sizeof(uTGAcompare));
+	header[12] = image.width % 256;
+	header[13] = image.width / 256;
+	header[14] = image.height % 256;
+	header[15] = image.height / 256;
+	header[16] = image.bpp;
+	header[17] = image.bpp == 32 ? 8 : 0;	//flag alpha depth and other flags
+
+	if(fwrite(header, 1, sizeof(header), file) != sizeof(header))
 	{
-		// 1st Byte XOR 3rd Byte XOR 1st Byte XOR 3rd Byte
-		imageData[cswap] ^= imageData[cswap+2] ^=
-		imageData[cswap] ^= imageData[cswap+2];
+		fclose(file);
+		return NULL;
 	}
+	return file;
+}
 
-	for (int i = 0; i < imageData.size(); ++i)
+bool tga::saveTGA(const TGAImage& image, const char * filename)
+{
+	FILE * file = createTGA(image, filename);
+	if(file == NULL)
+		return false;
+
+	SwapKernel swapRedBlue = cpuKernels(CpuIsa::Auto)->swapRedBlue;
+	const size_t bytesPerPixel = image.bpp / 8;
+	const size_t blockPixels = writeBlockSize / bytesPerPixel;
+	const size_t pixels = image.dataSize() / bytesPerPixel;
+	static thread_local std::vector<unsigned char> block;
+	block.resize(std::min(blockPixels, pixels) * bytesPerPixel);
+
+	//swap from RGB to BGR a block at a time and write it in one call
+	bool written = true;
+	for(size_t first = 0; first < pixels && written; first += blockPixels)
 	{
-		unsigned char x = imageData[i];
-		myfile << imageData[i];
+		size_t count = std::min(blockPixels, pixels - first);
+		swapRedBlue(image.data() + first * bytesPerPixel, block.data(), count, (int)bytesPerPixel);
+		written = fwrite(block.data(), bytesPerPixel, count, file) == count;
 	}
 
-	myfile.close();
+	return fclose(file) == 0 && written;
+}
+
+bool tga::saveTGAInPlace(TGAImage& image, const char * filename)
+{
+	FILE * file = createTGA(image, filename);
+	if(file == NULL)
+		return false;
 
-	return true;
+	//the image becomes BGR, written in a single call
+	const size_t bytesPerPixel = image.bpp / 8;
+	const size_t pixels = image.dataSize() / bytesPerPixel;
+	cpuKernels(CpuIsa::Auto)->swapRedBlue(image.data(), image.data(), pixels, (int)bytesPerPixel);
+	bool written = fwrite(image.data(), bytesPerPixel, pixels, file) == pixels;
+
+	return fclose(file) == 0 && written;
 }
 
 // Load A TGA File!
@@ -86,25 +111,28 @@ bool tga::LoadTGA(TGAImage * image, const char * filename)
 	
 
 
+	bool loaded;
 		// If The File Header Matches The Uncompressed Header
 	if(memcmp(uTGAcompare, &tgaheader, sizeof(tgaheader)) == 0)
 	{
 		// Load An Uncompressed TGA
-		LoadUncompressedTGA(image, filename, fTGA, tgaheader, tga_);
+		loaded = LoadUncompressedTGA(image, filename, fTGA, tgaheader, tga_);
 	}
 	// If The File Header Matches The Compressed Header
 	else if(memcmp(cTGAcompare, &tgaheader, sizeof(tgaheader)) == 0)
 	{
 		// Load A Compressed TGA
-		LoadCompressedTGA(image, filename, fTGA, tgaheader, tga_);
+		loaded = LoadCompressedTGA(image, filename, fTGA, tgaheader, tga_);
 	}
 	else						// If It Doesn't Match Either One
 	{
 		std::cout << "loadTGA: error: tga file header does not match\n";
-		return false;				// Return False
+		loaded = false;
 	}
 
-	return true;
+	// the loaders leave the file open, it is closed here whether they succeed or not
+	fclose(fTGA);					// Close The File
+	return loaded;
 }
 
 // Load An Uncompressed TGA
@@ -141,7 +169,7 @@ bool tga::LoadUncompressedTGA(tga::TGAImage * image, const char * filename, FILE
 	tga_.imageSize = (tga_.bytesPerPixel * tga_.Width * tga_.Height);
 
 	// Allocate Memory
-	image->imageData = std::vector<unsigned char>(tga_.imageSize);//(char *)malloc(tga_.imageSize);
+	image->imageData = tga::ImageData(tga_.imageSize);//(char *)malloc(tga_.imageSize);
 	//if(image->imageData == NULL)			// Make Sure It Was Allocated Ok
 	//{
 	//	std::cout << "loadTGA: error: image data was not allocated properly\n";
@@ -164,7 +192,6 @@ bool tga::LoadUncompressedTGA(tga::TGAImage * image, const char * filename, FILE
 		image->imageData[cswap] ^= image->imageData[cswap+2];
 	}
 
-	fclose(fTGA);					// Close The File
 	return true;					// Return Success
 
 }
@@ -202,83 +229,69 @@ bool tga::LoadCompressedTGA(tga::TGAImage * image, const char * filename, FILE *
 	tga.imageSize = (tga.bytesPerPixel * tga.Width * tga.Height);
 
 	// Allocate Memory To Store Image Data
-	image->imageData	= std::vector<unsigned char>(tga.imageSize);
-
-	unsigned int pixelcount = tga.Height * tga.Width;	// Number Of Pixels In The Image
-	unsigned int currentpixel	= 0;			// Current Pixel We Are Reading From Data
-	unsigned int currentbyte	= 0;			// Current Byte We Are Writing Into Imagedata
-	// Storage For 1 Pixel
-	unsigned char * colorbuffer = (unsigned char *)malloc(tga.bytesPerPixel);
-
-	do						// Start Loop
-	{
-	unsigned char chunkheader = 0;			// Variable To Store The Value Of The Id Chunk
-	if(fread(&chunkheader, sizeof(unsigned char), 1, fTGA) == 0)	// Attempt To Read The Chunk's Header
+	size_t pixelcount = (size_t)tga.Width * tga.Height;	// Number Of Pixels In The Image
+	size_t bytesPerPixel = tga.bytesPerPixel;
+	image->imageData	= tga::ImageData(pixelcount * bytesPerPixel);
+
+	// Read the whole payload in one call. Even with a chunk header for every pixel it is at most
+	// pixelcount * (bytesPerPixel + 1) bytes long, what follows the pixels in the file is not read
+	std::error_code error;
+	unsigned long long fileSize = std::filesystem::file_size(filename, error);
+	size_t payloadSize = pixelcount * (bytesPerPixel + 1);
+	if(!error && fileSize >= 18)
+		payloadSize = (size_t)std::min<unsigned long long>(payloadSize, fileSize - 18);
+	std::vector<unsigned char> payload(payloadSize);
+	payloadSize = fread(payload.data(), 1, payload.size(), fTGA);
+
+	// Raw chunks are swapped from BGR to RGB straight into the image, runs swap their pixel once
+	// and fill the rest by doubling the part already filled. Every chunk is checked against the
+	// end of the payload and of the image before it is copied
+	SwapKernel swapRedBlue = cpuKernels(CpuIsa::Auto)->swapRedBlue;
+	unsigned char * target = image->imageData.data();
+	size_t position = 0;
+	size_t currentpixel = 0;
+	while(currentpixel < pixelcount)
 	{
-		std::cout << "loadTGA: error reading chunk header \n";
-		free(colorbuffer);
-		return false;				// If It Fails, Return False
-	}
+		if(position >= payloadSize)
+		{
+			std::cout << "loadTGA: error reading chunk header \n";
+			return false;
+		}
 
-	if(chunkheader < 128)				// If The Chunk Is A 'RAW' Chunk
-	{
-		chunkheader++;				// Add 1 To The Value To Get Total Number Of Raw Pixels
+		unsigned char chunkheader = payload[position++];
+		bool raw = chunkheader < 128;			// A 'RAW' Chunk Or An RLE Header
+		size_t count = raw ? chunkheader + 1 : chunkheader - 127;
+		size_t bytes = (raw ? count : 1) * bytesPerPixel;
+		if(count > pixelcount - currentpixel)
+		{
+			std::cout << "loadTGA: error: a chunk of " << count << " pixels runs past the end of the image\n";
+			return false;
+		}
+		if(bytes > payloadSize - position)
+		{
+			std::cout << "loadTGA: error reading image data\n";
+			return false;
+		}
 
-	// Start Pixel Reading Loop
-	for(short counter = 0; counter < chunkheader; counter++)
-	{
-		// Try To Read 1 Pixel
-		if(fread(colorbuffer, 1, tga.bytesPerPixel, fTGA) != tga.bytesPerPixel)
+		unsigned char * pixel = target + currentpixel * bytesPerPixel;
+		if(raw)
 		{
-			std::cout << "loadTGA: error reading a single pixel\n";
-			free(colorbuffer);
-			return false;			// If It Fails, Return False
+			swapRedBlue(&payload[position], pixel, count, (int)bytesPerPixel);
 		}
-	image->imageData[currentbyte] = colorbuffer[2];		// Write The 'R' Byte
-	image->imageData[currentbyte + 1	] = colorbuffer[1];	// Write The 'G' Byte
-	image->imageData[currentbyte + 2	] = colorbuffer[0];	// Write The 'B' Byte
-	if(tga.bytesPerPixel == 4)					// If It's A 32bpp Image...
-	{
-		image->imageData[currentbyte + 3] = colorbuffer[3];	// Write The 'A' Byte
-	}
-	// Increment The Byte Counter By The Number Of Bytes In A Pixel
-	currentbyte += tga.bytesPerPixel;
-	currentpixel++;					// Increment The Number Of Pixels By 1
-	}
-	}
-	else						// If It's An RLE Header
-	{
-		chunkheader -= 127;			// Subtract 127 To Get Rid Of The ID Bit
-	// Read The Next Pixel
-	if(fread(colorbuffer, 1, tga.bytesPerPixel, fTGA) != tga.bytesPerPixel)
-	{
-		std::cout << "loadTGA: error reading a single pixel\n";
-		free(colorbuffer);
-		return false;				// If It Fails, Return False
-	}
-	// Start The Loop
-	for(short counter = 0; counter < chunkheader; counter++)
-	{
-		// Copy The 'R' Byte
-		image->imageData[currentbyte] = colorbuffer[2];
-		// Copy The 'G' Byte
-		image->imageData[currentbyte + 1	] = colorbuffer[1];
-		// Copy The 'B' Byte
-		image->imageData[currentbyte + 2	] = colorbuffer[0];
-		if(tga.bytesPerPixel == 4)		// If It's A 32bpp Image
+		else
 		{
-			// Copy The 'A' Byte
-			image->imageData[currentbyte + 3] = colorbuffer[3];
+			swapRedBlue(&payload[position], pixel, 1, (int)bytesPerPixel);
+			for(size_t filled = 1; filled < count; )
+			{
+				size_t copied = std::min(filled, count - filled);
+				memcpy(pixel + filled * bytesPerPixel, pixel, copied * bytesPerPixel);
+				filled += copied;
+			}
 		}
-		currentbyte += tga.bytesPerPixel;	// Increment The Byte Counter
-		currentpixel++;				// Increment The Pixel Counter
-	}
-	}
 
-	}while(currentpixel < pixelcount);
+		position += bytes;
+		currentpixel += count;
+	}
 
-	fclose(fTGA);
-	free(colorbuffer);
 	return true;
-
 }
@@ -9,17 +9,48 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include <stdio.h>				// Standard Header For File I/O
+#include <new>
 #include <vector>
 
 namespace tga{
 
-typedef struct
+// Hands out page aligned memory, OpenCL devices that share memory with the host
+// can then use the image data in place instead of copying it
+template <typename T>
+struct PageAlignedAllocator
 {
-        std::vector<unsigned char> imageData;			// Hold All The Color Values For The Image.
+        typedef T value_type;
+        static const size_t alignment = 4096;
+
+        PageAlignedAllocator() = default;
+        template <typename U> PageAlignedAllocator(const PageAlignedAllocator<U>&) {}
+
+        T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignment))); }
+        void deallocate(T* p, size_t) { ::operator delete(p, std::align_val_t(alignment)); }
+};
+
+template <typename T, typename U>
+bool operator==(const PageAlignedAllocator<T>&, const PageAlignedAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const PageAlignedAllocator<T>&, const PageAlignedAllocator<U>&) { return false; }
+
+typedef std::vector<unsigned char, PageAlignedAllocator<unsigned char>> ImageData;
+
+typedef struct TGAImage
+{
+        ImageData imageData;			// Hold All The Color Values For The Image.
         unsigned int  bpp;				// Hold The Number Of Bits Per Pixel.
         unsigned int width;				// The Width Of The Entire Image.
         unsigned int height;				// The Height Of The Entire Image.
         unsigned int type;			 	// Data Stored In * ImageData (GL_RGB Or GL_RGBA)
+
+        // Pixels the image does not own, like those of a memory mapped file. When set they are
+        // used instead of imageData, copies of the image refer to the same pixels.
+        unsigned char* externalData = NULL;
+
+        unsigned char* data() { return externalData ? externalData : imageData.data(); }
+        const unsigned char* data() const { return externalData ? externalData : imageData.data(); }
+        size_t dataSize() const { return externalData ? (size_t)width * height * (bpp / 8) : imageData.size(); }
 } TGAImage;
 
 typedef struct
@@ -39,8 +70,11 @@ typedef struct
 } TGA;
 
 bool saveTGA(const TGAImage& image, const char * filename); //save as uncompressed tga
+// save without a copy when the image is not needed anymore, its pixels are BGR(A) afterwards
+bool saveTGAInPlace(TGAImage& image, const char * filename);
 
 bool LoadTGA(TGAImage* image, const char * filename);
+// the loaders read the file past its header, LoadTGA opens it and closes it again
 // Load An Uncompressed File
 bool LoadUncompressedTGA(TGAImage *, const char *, FILE *, tga::TGAHeader&, tga::TGA&);
 // Load A Compressed File
@@ -0,0 +1,65 @@
+#include "tga_mapped.h"
+#include <string.h>
+#include <iostream>
+
+// the header of the uncompressed true color images, the same LoadTGA reads and saveTGA writes
+static const unsigned char uncompressedHeader[12] = {0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static const size_t headerSize = 18;
+
+bool tga::MappedTGA::openRead(const char* filename) {
+    if (!file.openRead(filename)) {
+        std::cout << "loadTGA: error reading file " << filename << std::endl;
+        return false;
+    }
+
+    const unsigned char* header = file.data();
+    if (file.size() < headerSize || memcmp(header, uncompressedHeader, sizeof(uncompressedHeader)) != 0) {
+        std::cout << "loadTGA: error: " << filename << " is not an uncompressed tga\n";
+        close();
+        return false;
+    }
+
+    mappedImage.width = header[13] * 256 + header[12];
+    mappedImage.height = header[15] * 256 + header[14];
+    mappedImage.bpp = header[16];
+    mappedImage.type = mappedImage.bpp == 32 ? 1 : 0;
+    if (mappedImage.width == 0 || mappedImage.height == 0 || (mappedImage.bpp != 24 && mappedImage.bpp != 32)) {
+        std::cout << "loadTGA: error: width/height or bbp invalid\n";
+        close();
+        return false;
+    }
+
+    if (file.size() < headerSize + (size_t)mappedImage.width * mappedImage.height * (mappedImage.bpp / 8)) {
+        std::cout << "loadTGA: error reading image data\n";
+        close();
+        return false;
+    }
+
+    // the pixels are never written, the mapping is read only
+    mappedImage.externalData = const_cast<unsigned char*>(header) + headerSize;
+    return true;
+}
+
+bool tga::MappedTGA::create(const char* filename, unsigned int width, unsigned int height, unsigned int bpp) {
+    mappedImage.width = width;
+    mappedImage.height = height;
+    mappedImage.bpp = bpp;
+    mappedImage.type = bpp == 32 ? 1 : 0;
+
+    if (!file.create(filename, headerSize + (size_t)width * height * (bpp / 8))) {
+        std::cout << "saveTGA: error writing file " << filename << std::endl;
+        return false;
+    }
+
+    unsigned char* header = file.data();
+    memcpy(header, uncompressedHeader, sizeof(uncompressedHeader));
+    header[12] = width % 256;
+    header[13] = width / 256;
+    header[14] = height % 256;
+    header[15] = height / 256;
+    header[16] = bpp;
+    header[17] = bpp == 32 ? 8 : 0;
+
+    mappedImage.externalData = header + headerSize;
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef GAUSSIAN_BLUR_TGA_MAPPED_H
+#define GAUSSIAN_BLUR_TGA_MAPPED_H
+
+#include "mapped_file.h"
+#include "tga.h"
+
+namespace tga {
+
+// An uncompressed tga whose pixels are used in place in the memory mapped file, neither read
+// into a buffer nor zero filled first. The pixels stay BGR(A) as they are stored. The blur
+// does not mind, it treats the color channels alike and alpha is the fourth byte either way.
+// The pixels start behind the 18 byte header, they are not page aligned, so OpenCL devices
+// copy them to and from device memory even in zero copy mode.
+class MappedTGA {
+public:
+    // maps an existing uncompressed tga read only, its pixels must not be written
+    bool openRead(const char* filename);
+
+    // creates an uncompressed tga with the header written and the pixels left to the caller
+    bool create(const char* filename, unsigned int width, unsigned int height, unsigned int bpp);
+
+    void close() {
+        file.close();
+        mappedImage.externalData = NULL;
+    }
+
+    // the image refers to the mapped pixels through externalData
+    TGAImage& image() { return mappedImage; }
+
+private:
+    MappedFile file;
+    TGAImage mappedImage;
+};
+
+}
+
+#endif //GAUSSIAN_BLUR_TGA_MAPPED_H
@@ -0,0 +1,167 @@
+#include "tga_stream.h"
+#include <string.h>
+#include <algorithm>
+#include <iostream>
+#include "cpu_kernels.h"
+
+// the first 12 header bytes of the uncompressed and the run length encoded true color images LoadTGA reads
+static const unsigned char uncompressedHeader[12] = {0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+static const unsigned char compressedHeader[12] = {0, 0, 10, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+// tga stores BGR(A), the images are RGB(A)
+static void swapRedBlue(unsigned char* data, size_t pixels, size_t bytesPerPixel) {
+    cpuKernels(CpuIsa::Auto)->swapRedBlue(data, data, pixels, (int)bytesPerPixel);
+}
+
+tga::TGAStripReader::~TGAStripReader() {
+    close();
+}
+
+void tga::TGAStripReader::close() {
+    if (file)
+        fclose(file);
+    file = NULL;
+}
+
+bool tga::TGAStripReader::open(const char* filename) {
+    file = fopen(filename, "rb");
+    if (!file) {
+        std::cout << "loadTGA: error reading file " << filename << std::endl;
+        return false;
+    }
+
+    unsigned char header[18];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+        std::cout << "loadTGA: error reading the tga file header\n";
+        return false;
+    }
+
+    if (memcmp(header, uncompressedHeader, sizeof(uncompressedHeader)) == 0) {
+        compressed = false;
+    } else if (memcmp(header, compressedHeader, sizeof(compressedHeader)) == 0) {
+        compressed = true;
+    } else {
+        std::cout << "loadTGA: error: tga file header does not match\n";
+        return false;
+    }
+
+    imageWidth = header[13] * 256 + header[12];
+    imageHeight = header[15] * 256 + header[14];
+    bitsPerPixel = header[16];
+    if (imageWidth == 0 || imageHeight == 0 || (bitsPerPixel != 24 && bitsPerPixel != 32)) {
+        std::cout << "loadTGA: error: width/height or bbp invalid\n";
+        return false;
+    }
+
+    nextRow = 0;
+    runPixels = 0;
+    return true;
+}
+
+bool tga::TGAStripReader::readPixels(unsigned char* data, size_t pixels) {
+    size_t bytesPerPixel = bitsPerPixel / 8;
+
+    if (!compressed) {
+        if (fread(data, bytesPerPixel, pixels, file) != pixels)
+            return false;
+        swapRedBlue(data, pixels, bytesPerPixel);
+        return true;
+    }
+
+    while (pixels > 0) {
+        if (runPixels == 0) {
+            int chunkHeader = fgetc(file);
+            if (chunkHeader == EOF)
+                return false;
+            // a raw chunk holds up to 128 pixels, a run repeats the one pixel after its header
+            runRepeats = chunkHeader >= 128;
+            runPixels = runRepeats ? chunkHeader - 127 : chunkHeader + 1;
+            if (runRepeats) {
+                if (fread(runPixel, 1, bytesPerPixel, file) != bytesPerPixel)
+                    return false;
+                swapRedBlue(runPixel, 1, bytesPerPixel);
+            }
+        }
+
+        size_t count = std::min(runPixels, pixels);
+        if (runRepeats) {
+            for (size_t i = 0; i < count; i++)
+                memcpy(data + i * bytesPerPixel, runPixel, bytesPerPixel);
+        } else {
+            if (fread(data, bytesPerPixel, count, file) != count)
+                return false;
+            swapRedBlue(data, count, bytesPerPixel);
+        }
+
+        data += count * bytesPerPixel;
+        pixels -= count;
+        runPixels -= count;
+    }
+    return true;
+}
+
+bool tga::TGAStripReader::readRows(unsigned char* data, unsigned int rows) {
+    if (!file || rows > imageHeight - nextRow)
+        return false;
+
+    if (!readPixels(data, (size_t)rows * imageWidth)) {
+        std::cout << "loadTGA: error reading image data\n";
+        return false;
+    }
+    nextRow += rows;
+    return true;
+}
+
+tga::TGAStripWriter::~TGAStripWriter() {
+    if (file)
+        fclose(file);
+}
+
+bool tga::TGAStripWriter::open(const char* filename, unsigned int width, unsigned int height, unsigned int bpp) {
+    file = fopen(filename, "wb");
+    if (!file) {
+        std::cout << "saveTGA: error writing file " << filename << std::endl;
+        return false;
+    }
+
+    imageWidth = width;
+    imageHeight = height;
+    bitsPerPixel = bpp;
+    nextRow = 0;
+
+    // the same header saveTGA writes
+    unsigned char header[18];
+    memcpy(header, uncompressedHeader, sizeof(uncompressedHeader));
+    header[12] = width % 256;
+    header[13] = width / 256;
+    header[14] = height % 256;
+    header[15] = height / 256;
+    header[16] = bpp;
+    header[17] = bpp == 32 ? 8 : 0;
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool tga::TGAStripWriter::writeRows(const unsigned char* data, unsigned int rows) {
+    if (!file || rows > imageHeight - nextRow)
+        return false;
+
+    size_t bytesPerPixel = bitsPerPixel / 8;
+    size_t size = (size_t)rows * imageWidth * bytesPerPixel;
+    buffer.resize(size);
+    cpuKernels(CpuIsa::Auto)->swapRedBlue(data, buffer.data(), (size_t)rows * imageWidth, (int)bytesPerPixel);
+    if (fwrite(buffer.data(), 1, size, file) != size)
+        return false;
+
+    nextRow += rows;
+    return true;
+}
+
+bool tga::TGAStripWriter::close() {
+    if (!file)
+        return false;
+
+    bool complete = nextRow == imageHeight;
+    bool closed = fclose(file) == 0;
+    file = NULL;
+    return complete && closed;
+}
@@ -0,0 +1,79 @@
+#ifndef GAUSSIAN_BLUR_TGA_STREAM_H
+#define GAUSSIAN_BLUR_TGA_STREAM_H
+
+#include <stdio.h>
+#include <vector>
+
+namespace tga {
+
+// Reads an uncompressed or run length encoded tga a few rows at a time, in the order the rows
+// are stored in the file, which is the order LoadTGA returns them in. The rows are RGB or RGBA
+// like the image data of LoadTGA, only the rows asked for are ever in memory.
+class TGAStripReader {
+public:
+    TGAStripReader() = default;
+    ~TGAStripReader();
+
+    TGAStripReader(const TGAStripReader&) = delete;
+    TGAStripReader& operator=(const TGAStripReader&) = delete;
+
+    // reads and checks the header, false if the file can not be read
+    bool open(const char* filename);
+
+    // reads the next rows into data, which holds rows * rowSize() bytes
+    bool readRows(unsigned char* data, unsigned int rows);
+
+    void close();
+
+    unsigned int width() const { return imageWidth; }
+    unsigned int height() const { return imageHeight; }
+    unsigned int bpp() const { return bitsPerPixel; }
+    size_t rowSize() const { return (size_t)imageWidth * (bitsPerPixel / 8); }
+    unsigned int rowsRead() const { return nextRow; }
+
+private:
+    bool readPixels(unsigned char* data, size_t pixels);
+
+    FILE* file = NULL;
+    bool compressed = false;
+    unsigned int imageWidth = 0;
+    unsigned int imageHeight = 0;
+    unsigned int bitsPerPixel = 0;
+    unsigned int nextRow = 0;
+
+    // a run of a compressed image may continue in the next rows
+    size_t runPixels = 0;
+    bool runRepeats = false;
+    unsigned char runPixel[4] = {};
+};
+
+// Writes an uncompressed tga a few rows at a time, the counterpart of TGAStripReader. The
+// header is written by open, the file is complete once all rows have been written and it is closed.
+class TGAStripWriter {
+public:
+    TGAStripWriter() = default;
+    ~TGAStripWriter();
+
+    TGAStripWriter(const TGAStripWriter&) = delete;
+    TGAStripWriter& operator=(const TGAStripWriter&) = delete;
+
+    bool open(const char* filename, unsigned int width, unsigned int height, unsigned int bpp);
+
+    // appends RGB or RGBA rows, they are swapped to BGR in a buffer of their own
+    bool writeRows(const unsigned char* data, unsigned int rows);
+
+    // false if writing failed or not all rows have been written
+    bool close();
+
+private:
+    FILE* file = NULL;
+    unsigned int imageWidth = 0;
+    unsigned int imageHeight = 0;
+    unsigned int bitsPerPixel = 0;
+    unsigned int nextRow = 0;
+    std::vector<unsigned char> buffer;
+};
+
+}
+
+#endif //GAUSSIAN_BLUR_TGA_STREAM_H
@@ -0,0 +1,68 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(int threads) : next(0) {
+    if (threads <= 0)
+        threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0)
+        threads = 1;
+
+    for (int i = 1; i < threads; i++)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::runTasks() {
+    // the tasks are handed out one by one, so uneven tasks still balance across the threads
+    for (int i = next++; i < count; i = next++)
+        (*task)(i);
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& task) {
+    if (count <= 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        this->count = count;
+        next = 0;
+        active = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    runTasks();
+
+    // every worker has to see this loop before the next one may start
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&]() { return active == 0; });
+    this->task = nullptr;
+}
+
+void ThreadPool::work() {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        runTasks();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--active == 0)
+            done.notify_all();
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef GAUSSIAN_BLUR_THREAD_POOL_H
+#define GAUSSIAN_BLUR_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for data parallel loops. The threads are started once and
+// sleep between loops, so blurring many images does not pay for thread creation every time.
+class ThreadPool {
+public:
+    // zero starts one thread per hardware thread, the calling thread counts as one of them
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int threadCount() const { return (int)workers.size() + 1; }
+
+    // runs task(i) for every i in [0, count) on all threads and returns once all calls are done
+    void parallelFor(int count, const std::function<void(int)>& task);
+
+private:
+    void work();
+    void runTasks();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(int)>* task = nullptr;
+    int count = 0;
+    std::atomic<int> next;
+    int active = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
+
+#endif //GAUSSIAN_BLUR_THREAD_POOL_H
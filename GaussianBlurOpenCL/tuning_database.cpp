@@ -0,0 +1,113 @@
+#include "tuning_database.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <tuple>
+#include <vector>
+#include "temporary_file.h"
+
+bool TuningKey::operator<(const TuningKey& other) const {
+    return std::tie(device, kernelSize, precision, channels, verticalPass) < std::tie(other.device, other.kernelSize, other.precision, other.channels, other.verticalPass);
+}
+
+TuningDatabase::TuningDatabase(const std::string& fileName) : fileName(fileName) {
+    if (!fileName.empty())
+        load(fileName, entries);
+}
+
+static std::vector<std::string> split(const std::string& line, char separator) {
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, separator))
+        fields.push_back(field);
+    return fields;
+}
+
+static bool parsePass(const std::string& field, PassLaunch& pass) {
+    std::stringstream stream(field);
+    stream >> pass.localWorkSize[0] >> pass.localWorkSize[1] >> pass.pixelsPerItem;
+    return !stream.fail() && pass.localWorkSize[0] > 0 && pass.localWorkSize[1] > 0 && pass.pixelsPerItem > 0;
+}
+
+void TuningDatabase::load(const std::string& fileName, std::map<TuningKey, TunedLaunch>& entries) {
+    std::ifstream file(fileName);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        // device, kernel size, precision, channels, vertical pass, horizontal launch, vertical launch, time.
+        // Databases written before the vertical pass was part of the key tuned the direct pass.
+        std::vector<std::string> fields = split(line, '\t');
+        if (fields.size() == 7)
+            fields.insert(fields.begin() + 4, "direct");
+        if (fields.size() != 8)
+            continue;
+
+        TuningKey key;
+        TunedLaunch launch;
+        try {
+            key.device = fields[0];
+            key.kernelSize = std::stoi(fields[1]);
+            key.precision = fields[2];
+            key.channels = std::stoi(fields[3]);
+            key.verticalPass = fields[4];
+            launch.milliseconds = std::stod(fields[7]);
+        } catch (const std::exception&) {
+            continue;
+        }
+
+        // damaged lines are skipped, the heuristic launch is used for them
+        if (parsePass(fields[5], launch.horizontal) && parsePass(fields[6], launch.vertical))
+            entries[key] = launch;
+    }
+}
+
+bool TuningDatabase::find(const TuningKey& key, TunedLaunch& launch) const {
+    auto entry = entries.find(key);
+    if (entry == entries.end())
+        return false;
+    launch = entry->second;
+    return true;
+}
+
+void TuningDatabase::store(const TuningKey& key, const TunedLaunch& launch) {
+    entries[key] = launch;
+}
+
+bool TuningDatabase::save() const {
+    if (fileName.empty())
+        return true;
+
+    // another device or run may have added entries since this database was loaded
+    std::map<TuningKey, TunedLaunch> merged;
+    load(fileName, merged);
+    for (const auto& entry : entries)
+        merged[entry.first] = entry.second;
+
+    // write to a temporary file of this thread first so a concurrent run never reads half a database
+    std::string temporary = temporaryPath(fileName);
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::trunc);
+        file << "# gaussian blur tuning database, written by --autotune\n";
+        file << "# device\tkernel size\tprecision\tchannels\tvertical pass\thorizontal x y pixels\tvertical x y pixels\tms\n";
+        for (const auto& entry : merged) {
+            const TunedLaunch& launch = entry.second;
+            file << entry.first.device << '\t' << entry.first.kernelSize << '\t' << entry.first.precision << '\t' << entry.first.channels << '\t' << entry.first.verticalPass << '\t'
+                 << launch.horizontal.localWorkSize[0] << ' ' << launch.horizontal.localWorkSize[1] << ' ' << launch.horizontal.pixelsPerItem << '\t'
+                 << launch.vertical.localWorkSize[0] << ' ' << launch.vertical.localWorkSize[1] << ' ' << launch.vertical.pixelsPerItem << '\t'
+                 << launch.milliseconds << '\n';
+        }
+        file.close();
+        if (!file.good()) {
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    return replaceWithTemporary(temporary, fileName);
+}
@@ -0,0 +1,52 @@
+#ifndef GAUSSIAN_BLUR_TUNING_DATABASE_H
+#define GAUSSIAN_BLUR_TUNING_DATABASE_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+// work-group shape and pixels per work-item of one blur pass
+struct PassLaunch {
+    size_t localWorkSize[2] = { 0, 0 };
+    int pixelsPerItem = 0;
+};
+
+// the fastest launch found by the autotuner, vertical is the launch of the row kernel on the
+// transposed image when the vertical pass is transposed
+struct TunedLaunch {
+    PassLaunch horizontal;
+    PassLaunch vertical;
+    double milliseconds = 0.0;
+};
+
+// what a tuned launch is valid for, the device is identified by platform, name and driver version
+struct TuningKey {
+    std::string device;
+    int kernelSize = 0;
+    std::string precision;
+    int channels = 0;
+    // the vertical pass, direct or transposed, they run different kernels
+    std::string verticalPass;
+
+    bool operator<(const TuningKey& other) const;
+};
+
+// A text file with one tuned launch per line, written by --autotune and read by every later run.
+// Saving merges with the entries already in the file, so devices and runs can share one database.
+class TuningDatabase {
+public:
+    // an empty file name keeps the database in memory only
+    explicit TuningDatabase(const std::string& fileName = "");
+
+    bool find(const TuningKey& key, TunedLaunch& launch) const;
+    void store(const TuningKey& key, const TunedLaunch& launch);
+    bool save() const;
+
+private:
+    static void load(const std::string& fileName, std::map<TuningKey, TunedLaunch>& entries);
+
+    std::string fileName;
+    std::map<TuningKey, TunedLaunch> entries;
+};
+
+#endif //GAUSSIAN_BLUR_TUNING_DATABASE_H